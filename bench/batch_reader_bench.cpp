@@ -0,0 +1,213 @@
+// Compares the backends of BatchReader reading one "stat" file per process,
+// like a tick of the monitor does. For each backend it reports the wall time
+// and the CPU time (user and system, including the io_uring workers) of a
+// tick, and the system calls it makes, counted by tracing a tick with ptrace.
+//
+// Usage:
+//   batch_reader_bench [--processes <n>] [--ticks <n>] [--proc]
+//                      By default the files are read from a synthetic "/proc"
+//                      fixture with 10000 processes, created in a temporary
+//                      directory. With --proc the files of the running
+//                      processes are read instead.
+
+#include <fmt/format.h>
+#include <signal.h>
+#include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "batch_reader.h"
+
+namespace {
+
+// The content of the stat file of every process of the fixture.
+const char* kStatContent{
+    "4242 (bench) S 1 4242 4242 0 -1 4194560 2411 0 0 0 12 7 0 0 20 0 1 0 "
+    "1024 11747328 1162 18446744073709551615 94800000000000 94800000100000 "
+    "140730000000000 0 0 0 0 0 0 0 0 0 17 3 0 0 0 0 0 94800000200000 "
+    "94800000300000 94800000400000 140730000100000 140730000200000 "
+    "140730000200000 140730000300000 0\n"};
+
+// A temporary directory with a "<pid>/stat" file per process, removed on
+// destruction.
+class ProcFixture {
+ public:
+  explicit ProcFixture(int processes) {
+    char directory[]{"/tmp/batch_reader_bench.XXXXXX"};
+    if (mkdtemp(directory) == nullptr) {
+      throw std::runtime_error{"can't create the fixture directory"};
+    }
+    root_ = directory;
+    for (int pid = 1; pid <= processes; ++pid) {
+      const std::filesystem::path process{root_ / std::to_string(pid)};
+      std::filesystem::create_directory(process);
+      std::ofstream{process / "stat"} << kStatContent;
+    }
+  }
+  ProcFixture(const ProcFixture&) = delete;
+  ProcFixture& operator=(const ProcFixture&) = delete;
+  ~ProcFixture() { std::filesystem::remove_all(root_); }
+
+  const std::filesystem::path& Root() const { return root_; }
+
+ private:
+  std::filesystem::path root_{};
+};
+
+// Get the paths of the stat files of the processes in a "/proc" directory.
+std::pmr::vector<std::pmr::string> StatPaths(
+    const std::filesystem::path& root) {
+  std::pmr::vector<std::pmr::string> paths{};
+  for (const auto& entry : std::filesystem::directory_iterator{root}) {
+    const std::string name{entry.path().filename().string()};
+    if (!name.empty() &&
+        name.find_first_not_of("0123456789") == std::string::npos) {
+      paths.emplace_back((entry.path() / "stat").string());
+    }
+  }
+  return paths;
+}
+
+double CpuSeconds() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+         usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+// Count the system calls made by a tick of a backend. The tick runs in a
+// child process traced with ptrace, which stops it at the entry and exit of
+// every system call. The child creates its own reader, so the io_uring
+// instance and its registered buffer belong to it, and it stops itself with
+// SIGSTOP before and after the tick. The calls made by the second SIGSTOP are
+// measured with an empty tick and subtracted. It returns -1 if the child
+// can't be traced.
+long CountSystemCalls(const std::pmr::vector<std::pmr::string>& paths,
+                      bool io_uring, bool empty_tick) {
+  const pid_t child{fork()};
+  if (child < 0) {
+    return -1;
+  }
+  if (child == 0) {
+    BatchReader reader{};
+    if (io_uring) {
+      reader.EnableIoUring();
+    }
+    std::pmr::vector<std::pmr::string> contents{};
+    // A first tick, so the second one reuses the allocated contents.
+    reader.Read(paths, contents);
+    if (ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) != 0) {
+      _exit(1);
+    }
+    raise(SIGSTOP);
+    if (!empty_tick) {
+      reader.Read(paths, contents);
+    }
+    raise(SIGSTOP);
+    _exit(0);
+  }
+
+  int status{0};
+  if (waitpid(child, &status, 0) != child || !WIFSTOPPED(status)) {
+    return -1;
+  }
+  ptrace(PTRACE_SETOPTIONS, child, nullptr,
+         reinterpret_cast<void*>(PTRACE_O_TRACESYSGOOD));
+  ptrace(PTRACE_SYSCALL, child, nullptr, nullptr);
+  long stops{0};
+  while (waitpid(child, &status, 0) == child && WIFSTOPPED(status)) {
+    const int signal{WSTOPSIG(status)};
+    if (signal == (SIGTRAP | 0x80)) {
+      ++stops;
+      ptrace(PTRACE_SYSCALL, child, nullptr, nullptr);
+    } else if (signal == SIGSTOP) {
+      ptrace(PTRACE_DETACH, child, nullptr, nullptr);
+      break;
+    } else {
+      ptrace(PTRACE_SYSCALL, child, nullptr,
+             reinterpret_cast<void*>(static_cast<long>(signal)));
+    }
+  }
+  waitpid(child, &status, 0);
+  // Every call stops the child at its entry and at its exit.
+  return stops / 2;
+}
+
+void Run(const char* name, const std::pmr::vector<std::pmr::string>& paths,
+         int ticks, bool io_uring) {
+  BatchReader reader{};
+  if (io_uring && !reader.EnableIoUring()) {
+    fmt::print("{:<9} not available\n", name);
+    return;
+  }
+  std::pmr::vector<std::pmr::string> contents{};
+  reader.Read(paths, contents);
+  std::size_t files_read{0};
+  for (const std::pmr::string& content : contents) {
+    files_read += content.empty() ? 0 : 1;
+  }
+
+  const double cpu_start{CpuSeconds()};
+  const auto start = std::chrono::steady_clock::now();
+  for (int tick = 0; tick < ticks; ++tick) {
+    reader.Read(paths, contents);
+  }
+  const double wall_ms{
+      std::chrono::duration<double, std::milli>(
+          std::chrono::steady_clock::now() - start)
+          .count() /
+      ticks};
+  const double cpu_ms{(CpuSeconds() - cpu_start) * 1000 / ticks};
+
+  const long calls{CountSystemCalls(paths, io_uring, false)};
+  const long overhead{CountSystemCalls(paths, io_uring, true)};
+  const std::string calls_text{calls < 0 || overhead < 0
+                                   ? std::string{"n/a"}
+                                   : std::to_string(calls - overhead)};
+  fmt::print("{:<9} {:>10} {:>12.2f} {:>12.2f} {:>14}\n", name, files_read,
+             wall_ms, cpu_ms, calls_text);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int processes{10000};
+  int ticks{20};
+  bool use_proc{false};
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--processes") == 0 && i + 1 < argc) {
+      processes = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+      ticks = std::max(std::atoi(argv[++i]), 1);
+    } else if (std::strcmp(argv[i], "--proc") == 0) {
+      use_proc = true;
+    }
+  }
+
+  std::unique_ptr<ProcFixture> fixture{};
+  if (!use_proc) {
+    fixture = std::make_unique<ProcFixture>(processes);
+  }
+  const std::pmr::vector<std::pmr::string> paths{
+      StatPaths(use_proc ? std::filesystem::path{"/proc"} : fixture->Root())};
+  fmt::print("{} stat files from {}, {} ticks\n", paths.size(),
+             use_proc ? "/proc" : "a synthetic fixture", ticks);
+  fmt::print("{:<9} {:>10} {:>12} {:>12} {:>14}\n", "backend", "files",
+             "wall ms/tick", "cpu ms/tick", "syscalls/tick");
+  Run("sync", paths, ticks, false);
+  Run("io_uring", paths, ticks, true);
+  return 0;
+}
@@ -0,0 +1,66 @@
+#ifndef BATCH_READER_H
+#define BATCH_READER_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+// Reads many small files (e.g. one "/proc/<pid>/stat" per process) at once.
+//
+// By default the files are read one by one with open/read/close. When the
+// io_uring backend is enabled, the open, read and close of each file are
+// submitted as a chain of linked operations, a whole batch of files at a time,
+// and the kernel reads them into a registered buffer. So a batch of files
+// costs a couple of system calls instead of four per file.
+class BatchReader {
+ public:
+  // The mechanism used to read the files.
+  enum class Backend { kSync, kIoUring };
+
+  // Constructor. It starts with the synchronous backend.
+  //
+  // Parameters:
+  //  - batch_size: The maximum number of files submitted at once to io_uring.
+  explicit BatchReader(std::size_t batch_size = 256);
+  BatchReader(const BatchReader&) = delete;
+  BatchReader& operator=(const BatchReader&) = delete;
+  ~BatchReader();
+
+  // Switch to the io_uring backend. It returns false, and keeps the
+  // synchronous backend, if the kernel doesn't support (or allow) io_uring or
+  // any of the features we need (direct descriptors, Linux 5.15).
+  bool EnableIoUring();
+  // Get the backend in use.
+  Backend ActiveBackend() const;
+
+  // Read the files. The content of the file paths[i] is stored in contents[i],
+  // allocated from the contents resource. The content is empty if the file
+  // could not be read.
+  //
+  // Parameters:
+  //  - paths: The paths of the files.
+  //  - contents: Receives the contents of the files.
+  void Read(const std::pmr::vector<std::pmr::string>& paths,
+            std::pmr::vector<std::pmr::string>& contents);
+
+ private:
+  // The io_uring instance, defined in the source file so the kernel headers
+  // are not needed to use the reader.
+  struct Ring;
+
+  // Read a batch of files with io_uring. It returns false if io_uring failed,
+  // in which case the files must be read by other means. The requests in
+  // flight are canceled and waited for before returning, and if that fails
+  // the ring is leaked, since the kernel could still write to its buffer.
+  bool ReadBatch(const std::pmr::vector<std::pmr::string>& paths,
+                 std::size_t first, std::size_t count,
+                 std::pmr::vector<std::pmr::string>& contents);
+
+  std::size_t batch_size_{};
+  // The io_uring instance, or null when the synchronous backend is in use.
+  std::unique_ptr<Ring> ring_{};
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef BUDGET_GOVERNOR_H
+#define BUDGET_GOVERNOR_H
+
+#include <chrono>
+#include <memory_resource>
+
+// How much the monitor reduces its own work to stay under its CPU budget. Each
+// level includes the reductions of the previous ones.
+enum class DegradationLevel {
+  // Everything is sampled and shown.
+  kNone,
+  // The expensive per-process columns (scheduler statistics, NUMA placement)
+  // are not sampled, and the list is not sorted by them.
+  kNoExpensiveColumns,
+  // Only the first rows of the process list are sampled in full detail.
+  kFewerDetailedRows,
+  // The refresh interval is longer.
+  kSlowRefresh,
+};
+
+// Keeps the CPU used by the monitor itself under a budget.
+//
+// The CPU time of the monitor is read from "/proc/self/stat" once per tick.
+// When the usage goes over the budget the degradation level is raised, one
+// level at a time, and when the usage is well under the budget for a few
+// ticks it is lowered again.
+class BudgetGovernor {
+ public:
+  // Constructor.
+  //
+  // Parameters:
+  //  - budget: The CPU budget, as a fraction of one core (e.g. 0.01 is 1%).
+  explicit BudgetGovernor(float budget = 0.01f);
+
+  // Set the CPU budget, as a fraction of one core.
+  void SetBudget(float budget);
+  // Get the CPU budget, as a fraction of one core.
+  float Budget() const;
+  // Measure the CPU used by the monitor since the previous update, and adjust
+  // the degradation level. Consecutive calls with the same time point are
+  // ignored.
+  //
+  // Parameters:
+  //  - now: The time point of the current tick.
+  //  - resource: The memory resource used for the temporary allocations.
+  void Update(
+      std::chrono::steady_clock::time_point now,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+  // Get the CPU used by the monitor, as a fraction of one core, smoothed over
+  // the last ticks.
+  float Usage() const;
+  // Get the current degradation level.
+  DegradationLevel Level() const;
+  // Get a short description of a degradation level, to show in the UI.
+  static const char* Describe(DegradationLevel level);
+
+ private:
+  float budget_{};
+  float usage_{};
+  DegradationLevel level_{DegradationLevel::kNone};
+  // Number of consecutive updates over and well under the budget.
+  int ticks_over_budget_{};
+  int ticks_under_budget_{};
+  long long last_cpu_ticks_{};
+  std::chrono::steady_clock::time_point last_update_{};
+};
+
+#endif
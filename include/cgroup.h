@@ -0,0 +1,91 @@
+#ifndef CGROUP_H
+#define CGROUP_H
+
+#include <array>
+#include <chrono>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+#include "pressure.h"
+
+// Criteria that can be used to sort the cgroups view.
+enum class CgroupSortKey { kCpu, kMemory, kIo, kPids, kName };
+
+// Represent a control group of the unified (v2) cgroup hierarchy, that is
+// usually a container, a pod or a systemd service. You can use it to retrieve
+// the resource usage of all the processes in the group, including the ones that
+// already finished.
+class Cgroup {
+ public:
+  // Constructor.
+  //
+  // Parameters:
+  //  - path: The cgroup path relative to the hierarchy root, like it appears in
+  //  "/proc/<pid>/cgroup" (e.g. "/system.slice/ssh.service"). The root cgroup
+  //  is "/".
+  //  - depth: The number of ancestors of the cgroup.
+  explicit Cgroup(std::string path, int depth);
+
+  // Get the cgroup path relative to the hierarchy root.
+  const std::string& Path() const;
+  // Get the last component of the path (the root cgroup is named "/").
+  std::string_view Name() const;
+  // Get the path of the parent cgroup, or an empty view for the root.
+  std::string_view ParentPath() const;
+  // Get the number of ancestors of this cgroup.
+  int Depth() const;
+  // Get the CPU utilization of the group since the last update, in the same
+  // unit as Process::CpuUtilization (1.0 means all the CPUs fully used).
+  float CpuUtilization() const;
+  // Get the memory used by the group in bytes (memory.current).
+  long MemoryBytes() const;
+  // Get the anonymous memory used by the group in bytes.
+  long AnonymousMemoryBytes() const;
+  // Get the page cache memory used by the group in bytes.
+  long FileMemoryBytes() const;
+  // Get the rate of bytes read from block devices since the last update.
+  float ReadBytesPerSecond() const;
+  // Get the rate of bytes written to block devices since the last update.
+  float WriteBytesPerSecond() const;
+  // Get the number of processes in the group and its descendants.
+  long Pids() const;
+  // Get the percentage of time in the last 10 seconds in which some tasks of
+  // the group were stalled waiting for a resource, from the "*.pressure"
+  // files of the group.
+  float Pressure(PressureResource pressure_resource) const;
+  // Compare two cgroups according to a sort key. Bigger consumers come first,
+  // and names are sorted alphabetically.
+  static bool Less(const Cgroup& a, const Cgroup& b, CgroupSortKey key);
+
+  // Read the cgroup accounting files and update the rates.
+  //
+  // Parameters:
+  //  - root: The mount point of the cgroup hierarchy.
+  //  - now: The time the sample is being taken.
+  //  - resource: The memory resource used for the temporary allocations.
+  void Update(std::string_view root, std::chrono::steady_clock::time_point now,
+              std::pmr::memory_resource* resource);
+
+ private:
+  std::string path_{};
+  int depth_{};
+  // Cumulative counters read in the last update.
+  long usage_usec_{};
+  long read_bytes_{};
+  long write_bytes_{};
+  std::chrono::steady_clock::time_point last_update_{};
+  bool has_previous_sample_{false};
+  // Values derived from the last two updates.
+  float cpu_utilization_{};
+  float read_bytes_per_second_{};
+  float write_bytes_per_second_{};
+  long memory_bytes_{};
+  long anon_memory_bytes_{};
+  long file_memory_bytes_{};
+  long pids_{};
+  // Indexed by PressureResource.
+  std::array<float, 3> pressure_{};
+};
+
+#endif
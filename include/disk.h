@@ -0,0 +1,106 @@
+#ifndef DISK_H
+#define DISK_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+// The counters of a block device in "/proc/diskstats", in the file order
+// after the major, minor and device name columns. Older kernels have fewer
+// counters, and the missing ones are zero.
+enum DiskCounter : std::size_t {
+  kReadsCompleted,
+  kReadsMerged,
+  kSectorsRead,
+  kReadTimeMs,
+  kWritesCompleted,
+  kWritesMerged,
+  kSectorsWritten,
+  kWriteTimeMs,
+  kIosInProgress,
+  kIoTimeMs,
+  kWeightedIoTimeMs,
+  kDiscardsCompleted,
+  kDiscardsMerged,
+  kSectorsDiscarded,
+  kDiscardTimeMs,
+  kFlushesCompleted,
+  kFlushTimeMs,
+  kDiskCounterCount
+};
+
+// Which block devices are shown.
+enum class DiskFilter {
+  // Only the whole physical devices.
+  kPhysical,
+  // The physical devices and their partitions.
+  kPartitions,
+  // Every device, including the virtual ones (loop, zram, dm, md, ...).
+  kAll,
+};
+
+// Statistics of one block device.
+struct DiskStats {
+  unsigned major{};
+  unsigned minor{};
+  std::string name{};
+  // Whether it is a partition of another device.
+  bool partition{};
+  // Whether it is a virtual device, i.e., it is not backed by hardware.
+  bool is_virtual{};
+  // The cumulative counters, as reported by the kernel.
+  std::array<std::uint64_t, kDiskCounterCount> counters{};
+  // Rates in the interval between the previous and the last update.
+  float reads_per_second{};
+  float writes_per_second{};
+  float read_bytes_per_second{};
+  float write_bytes_per_second{};
+  // Average time each request took to complete, including the time in the
+  // queue, in milliseconds.
+  float read_latency_ms{};
+  float write_latency_ms{};
+  // Fraction of the time the device had requests in flight, in the interval
+  // [0, 1.0].
+  float utilization{};
+};
+
+// Reads the statistics of the block devices from "/proc/diskstats".
+class DiskMonitor {
+ public:
+  // Read the current statistics and calculate the rates in the interval since
+  // the previous update. The first update calculates the rates since the
+  // boot, and the devices that appear later have no rates until their second
+  // update. Consecutive calls with the same time point are ignored, so it can
+  // be called more than once in a tick.
+  //
+  // Parameters:
+  //  - now: The time point of the current tick.
+  //  - resource: The memory resource used for the temporary allocations.
+  void Update(
+      std::chrono::steady_clock::time_point now,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+  // Get the statistics of every device, in the file order, as of the last
+  // update.
+  const std::vector<DiskStats>& Devices() const;
+  // Get the busiest devices that pass the filter, sorted by utilization.
+  //
+  // Parameters:
+  //  - filter: Which devices are considered.
+  //  - n: The maximum number of devices returned.
+  const std::vector<const DiskStats*>& Busiest(DiskFilter filter,
+                                               std::size_t n);
+  // Check if a device passes a filter.
+  static bool Accepts(DiskFilter filter, const DiskStats& device);
+
+ private:
+  std::vector<DiskStats> devices_{};
+  // Reused to return the busiest devices without allocating memory.
+  std::vector<const DiskStats*> busiest_{};
+  std::chrono::steady_clock::time_point last_update_{};
+};
+
+#endif
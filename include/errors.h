@@ -5,13 +5,11 @@
 #include <exception>
 #include <string>
 
-#include "format.h"
-
 // Should be thrown when there is an error while opening a file.
 class OpenFileError : public std::exception {
  public:
   explicit OpenFileError(const std::string& file_path)
-      : what_{std::format("Could not open file: {}", file_path)} {}
+      : what_{"Could not open file: " + file_path} {}
   const char* what() const noexcept override { return what_.c_str(); }
 
  private:
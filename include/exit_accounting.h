@@ -0,0 +1,120 @@
+#ifndef EXIT_ACCOUNTING_H
+#define EXIT_ACCOUNTING_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The resources used by the tasks with the same command that exited recently.
+struct ExitedCommand {
+  // The command name (i.e. "comm", at most 15 characters).
+  std::string command{};
+  // The number of processes that exited. The threads are not counted, but
+  // their resources are.
+  std::uint64_t exits{};
+  // The CPU time (user and system) of the tasks, in seconds.
+  double cpu_seconds{};
+  // The CPU time of the tasks in the last interval, in seconds. The time of
+  // each task is assumed to be spread evenly over its lifetime.
+  double interval_cpu_seconds{};
+  // The share of all the CPUs used by the tasks in the last interval, in the
+  // interval [0, 1.0].
+  float cpu_utilization{};
+  // The highest RSS high-water mark of the tasks, in kilobytes.
+  std::uint64_t peak_rss_kilobytes{};
+  // The bytes the tasks read from and wrote to storage.
+  std::uint64_t read_bytes{};
+  std::uint64_t write_bytes{};
+  // When the last task exited.
+  std::chrono::steady_clock::time_point last_exit{};
+};
+
+// The tasks that exited in the last interval.
+struct ExitInterval {
+  // The number of processes that exited.
+  std::uint64_t exits{};
+  // The CPU time the tasks spent in the interval, in seconds.
+  double cpu_seconds{};
+  // The share of all the CPUs they used in the interval, in the interval
+  // [0, 1.0]. It is comparable with Processor::Utilization.
+  float cpu_utilization{};
+};
+
+// Collects the accounting record of every task that exits, from the taskstats
+// generic netlink interface. The process scans only see the processes alive
+// at each tick, so the short-lived ones (e.g. compilers and shell pipelines)
+// are missed, even when they use most of the CPU. The records are aggregated
+// by command name while the command keeps exiting, and forgotten some time
+// after its last exit.
+//
+// Registering for the records needs CAP_NET_ADMIN, so the collector is
+// disabled until Enable() succeeds.
+class ExitAccounting {
+ public:
+  ExitAccounting();
+  ExitAccounting(const ExitAccounting&) = delete;
+  ExitAccounting& operator=(const ExitAccounting&) = delete;
+  ~ExitAccounting();
+
+  // Register for the accounting records of the tasks that exit in any CPU. It
+  // returns false if the kernel doesn't support taskstats or we are not
+  // allowed to register (it needs CAP_NET_ADMIN).
+  //
+  // Parameters:
+  //  - now: The time point the collection starts.
+  bool Enable(std::chrono::steady_clock::time_point now =
+                  std::chrono::steady_clock::now());
+  // Check if the records are being collected.
+  bool Enabled() const;
+  // Read the records received since the previous update, without blocking,
+  // and aggregate them. It does nothing if the collector is disabled.
+  // Consecutive calls with the same time point are ignored, so it can be
+  // called more than once in a tick.
+  //
+  // Parameters:
+  //  - now: The time point of the current tick.
+  void Update(std::chrono::steady_clock::time_point now);
+  // Get the commands that used more CPU time, sorted by it.
+  //
+  // Parameters:
+  //  - n: The maximum number of commands returned.
+  const std::vector<const ExitedCommand*>& Busiest(std::size_t n);
+  // Get the tasks that exited in the last interval.
+  const ExitInterval& LastInterval() const;
+  // Get the number of times the socket buffer overflowed, so some records
+  // were lost.
+  std::uint64_t Overruns() const;
+
+ private:
+  // Read the messages in the socket. If wait_ack is true, it blocks until the
+  // acknowledgment of the last request and returns its error (zero or a
+  // negative errno). Otherwise it returns zero when there are no messages
+  // left.
+  int Receive(bool wait_ack);
+  // Parse the attributes of a message of the generic netlink controller.
+  void HandleFamily(const char* attributes, std::size_t size);
+  // Parse the attributes of a taskstats message and aggregate its record.
+  void HandleStats(const char* attributes, std::size_t size);
+
+  int socket_{-1};
+  // The generic netlink family id of taskstats, or zero if it is unknown.
+  std::uint16_t family_{};
+  std::vector<char> buffer_{};
+  std::unordered_map<std::string, ExitedCommand> commands_{};
+  // Reused to return the busiest commands without allocating memory.
+  std::vector<const ExitedCommand*> busiest_{};
+  // The records of the current interval, until it is closed by Update().
+  ExitInterval current_{};
+  ExitInterval last_interval_{};
+  std::uint64_t overruns_{};
+  // The length of the current interval, used to prorate the CPU time of the
+  // tasks.
+  std::chrono::steady_clock::duration interval_{};
+  std::chrono::steady_clock::time_point now_{};
+  std::chrono::steady_clock::time_point last_update_{};
+};
+
+#endif
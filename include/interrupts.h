@@ -0,0 +1,165 @@
+#ifndef INTERRUPTS_H
+#define INTERRUPTS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+// A source of interrupts, i.e. a row of "/proc/interrupts" or
+// "/proc/softirqs".
+struct InterruptSource {
+  // The IRQ number or name (e.g. "24", "NMI" or "NET_RX").
+  std::string name{};
+  // The controller, type and devices of the IRQ. It is empty for the softirqs.
+  std::string description{};
+  // Interrupts per second in all the CPUs in the last interval.
+  float rate{};
+  // The column of the CPU that handled most of the interrupts in the last
+  // interval, and its share of them, in the interval [0, 1.0].
+  int busiest_cpu{};
+  float busiest_share{};
+};
+
+// The interrupt counts of a file with one row per source and one column per
+// CPU, like "/proc/interrupts" and "/proc/softirqs".
+class InterruptMatrix {
+ public:
+  // Constructor.
+  //
+  // Parameters:
+  //  - path: The path of the file.
+  explicit InterruptMatrix(std::string path);
+  // Read the counts and calculate the rates in the interval since the previous
+  // update. The file is parsed in a single pass, and the counts are stored in
+  // a matrix that is only reallocated when sources or CPUs appear.
+  //
+  // Parameters:
+  //  - elapsed_seconds: The interval since the previous update.
+  //  - resource: The memory resource used for the temporary allocations.
+  void Update(double elapsed_seconds, std::pmr::memory_resource* resource);
+  // Get the number of CPUs in the file, i.e. of columns of the matrix.
+  int CpuCount() const;
+  // Get the id of the CPU of a column. They differ when some CPUs are offline.
+  //
+  // Parameters:
+  //  - cpu: The CPU column.
+  int CpuId(int cpu) const;
+  // Get the column of a CPU, or -1 if the file has no column for it. The files
+  // don't always list the same CPUs (e.g. "/proc/softirqs" lists the possible
+  // CPUs and "/proc/interrupts" the online ones).
+  //
+  // Parameters:
+  //  - cpu_id: The id of the CPU.
+  int CpuColumn(int cpu_id) const;
+  // Get the sources, in the file order, as of the last update.
+  const std::vector<InterruptSource>& Sources() const;
+  // Get the interrupts per second of a source in a CPU in the last interval.
+  //
+  // Parameters:
+  //  - source: The index of the source in Sources().
+  //  - cpu: The CPU column.
+  float Rate(std::size_t source, int cpu) const;
+
+ private:
+  std::string path_{};
+  int cpu_count_{};
+  std::vector<int> cpu_ids_{};
+  // The column of each CPU id, or -1 for the CPUs not in the file.
+  std::vector<int> cpu_columns_{};
+  std::vector<InterruptSource> sources_{};
+  // The counts and rates of the sources, in rows of cpu_count_ values.
+  std::vector<std::uint64_t> counts_{};
+  std::vector<float> rates_{};
+  // Whether the file was read before.
+  bool updated_{};
+};
+
+// The share of the time a CPU spent handling interrupts, in the interval
+// [0, 1.0].
+struct CoreInterruptTime {
+  float irq{};
+  float softirq{};
+};
+
+// A source of interrupts and the matrix it belongs to.
+struct InterruptSourceRef {
+  const InterruptMatrix* matrix{};
+  std::size_t index{};
+
+  const InterruptSource& Source() const { return matrix->Sources()[index]; }
+};
+
+// Reads the hardware and software interrupts handled by each CPU, and the
+// time they spent on them, to find the sources that are not balanced between
+// the CPUs.
+class InterruptMonitor {
+ public:
+  // Constructor.
+  //
+  // Parameters:
+  //  - interrupts_path: The file with the hardware interrupts.
+  //  - softirqs_path: The file with the software interrupts.
+  //  - stat_path: The file with the time spent by each CPU.
+  explicit InterruptMonitor(std::string interrupts_path = "/proc/interrupts",
+                            std::string softirqs_path = "/proc/softirqs",
+                            std::string stat_path = "/proc/stat");
+  // Read the counts and calculate the rates in the interval since the previous
+  // update. The first update calculates the rates since the boot. Consecutive
+  // calls with the same time point are ignored, so it can be called more than
+  // once in a tick.
+  //
+  // Parameters:
+  //  - now: The time point of the current tick.
+  //  - resource: The memory resource used for the temporary allocations.
+  void Update(
+      std::chrono::steady_clock::time_point now,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+  // Get the hardware interrupts, from "/proc/interrupts".
+  const InterruptMatrix& Hardware() const;
+  // Get the software interrupts, from "/proc/softirqs".
+  const InterruptMatrix& Software() const;
+  // Get the time spent by each CPU handling interrupts in the last interval,
+  // indexed by the CPU id. The CPUs that are offline have no time.
+  const std::vector<CoreInterruptTime>& CoreTimes() const;
+  // Get the busiest sources of both kinds, sorted by rate.
+  //
+  // Parameters:
+  //  - n: The maximum number of sources returned.
+  const std::vector<InterruptSourceRef>& Busiest(std::size_t n);
+  // Set the share of a source above which a CPU is considered overloaded by
+  // it.
+  //
+  // Parameters:
+  //  - threshold: The share, in the interval [0, 1.0].
+  void SetImbalanceThreshold(float threshold);
+  // Get the share of a source above which a CPU is considered overloaded by
+  // it.
+  float ImbalanceThreshold() const;
+  // Check if one CPU handled more than the threshold share of a source. Only
+  // the sources with a significant rate in machines with more than one CPU can
+  // be imbalanced.
+  //
+  // Parameters:
+  //  - source: The source.
+  bool Imbalanced(const InterruptSource& source) const;
+
+ private:
+  void UpdateCoreTimes(std::pmr::memory_resource* resource);
+
+  InterruptMatrix hardware_;
+  InterruptMatrix software_;
+  std::string stat_path_{};
+  std::vector<CoreInterruptTime> core_times_{};
+  // The total, irq and softirq jiffies of each CPU in the last update, indexed
+  // by the CPU id.
+  std::vector<std::uint64_t> core_jiffies_{};
+  // Reused to return the busiest sources without allocating memory.
+  std::vector<InterruptSourceRef> busiest_{};
+  float imbalance_threshold_{0.8f};
+  std::chrono::steady_clock::time_point last_update_{};
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef METRIC_SCHEDULER_H
+#define METRIC_SCHEDULER_H
+
+#include <chrono>
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+#include "process.h"
+
+// Refreshes the per-process metrics that are too expensive to read for every
+// process in every tick, like the memory detail from "/proc/<pid>/smaps_rollup"
+// (see Process::UpdateMemoryDetail).
+//
+// Each tick gets a fixed time budget. The priority processes (e.g. the visible
+// rows) are refreshed first, and the remaining budget is spent refreshing the
+// other processes with the oldest values, so every process is refreshed
+// eventually and the cost of a tick doesn't grow with the number of processes.
+class ExpensiveMetricScheduler {
+ public:
+  // Constructor.
+  //
+  // Parameters:
+  //  - budget: The maximum time spent refreshing metrics in each tick.
+  //  - refresh_interval: A value is not refreshed again before this interval.
+  //  - stale_after: A value older than this is considered stale.
+  explicit ExpensiveMetricScheduler(
+      std::chrono::microseconds budget = std::chrono::milliseconds{5},
+      std::chrono::milliseconds refresh_interval = std::chrono::seconds{1},
+      std::chrono::milliseconds stale_after = std::chrono::seconds{10});
+
+  // Refresh the metrics of the processes within the time budget.
+  //
+  // Parameters:
+  //  - processes: The processes whose metrics are refreshed.
+  //  - priority_first: The index of the first process refreshed before the
+  //  others, e.g. the first visible one.
+  //  - priority_count: The number of processes, from priority_first, that are
+  //  refreshed before the others.
+  //  - now: The time point of the current tick.
+  //  - resource: The memory resource used for the temporary allocations.
+  void Run(
+      std::vector<Process>& processes, std::size_t priority_first,
+      std::size_t priority_count,
+      std::chrono::steady_clock::time_point now,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+  // Check if the value of a metric sampled at the given time is stale.
+  //
+  // Parameters:
+  //  - sampled_at: When the value was sampled.
+  //  - now: The time point of the current tick.
+  bool IsStale(std::chrono::steady_clock::time_point sampled_at,
+               std::chrono::steady_clock::time_point now) const;
+
+ private:
+  std::chrono::microseconds budget_{};
+  std::chrono::milliseconds refresh_interval_{};
+  std::chrono::milliseconds stale_after_{};
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "snapshot.h"
+
+// Serves the sampled metrics in the OpenMetrics text format, so that they can
+// be scraped by Prometheus.
+//
+// The response body is rendered once per sample, in Render, and every scrape is
+// answered with that cached body. So scrapes never read "/proc", no matter how
+// many of them arrive between two samples. The scrapes are answered one at a
+// time by a background thread.
+class MetricsExporter {
+ public:
+  // Where the exporter listens for scrapes. If unix_socket_path is not empty a
+  // Unix socket is used, otherwise a TCP socket bound to the loopback address.
+  struct Endpoint {
+    std::string unix_socket_path{};
+    int port{9100};
+  };
+
+  // Parse an endpoint description. It can be a port number, which means a TCP
+  // socket in the loopback interface, or "unix:<path>" for a Unix socket. It
+  // throws an UnexpectedFormatError if the description is invalid.
+  //
+  // Parameters:
+  //  - description: The endpoint description.
+  static Endpoint ParseEndpoint(const std::string& description);
+
+  // Constructor. It starts listening in the endpoint in a background thread.
+  // It throws an OpenFileError if the socket can't be created.
+  //
+  // Parameters:
+  //  - endpoint: Where the exporter listens for scrapes.
+  //  - max_process_series: The maximum number of processes exported. The
+  //  processes with the highest CPU utilization are chosen.
+  explicit MetricsExporter(const Endpoint& endpoint,
+                           std::size_t max_process_series = 50);
+  MetricsExporter(const MetricsExporter&) = delete;
+  MetricsExporter& operator=(const MetricsExporter&) = delete;
+  ~MetricsExporter();
+
+  // Render the metrics of a sample into the body served to the next scrapes.
+  //
+  // Parameters:
+  //  - view: The sample we want to export.
+  void Render(const snapshot::SnapshotView& view);
+
+ private:
+  // Accept and answer the scrapes until the exporter is destroyed.
+  void Serve();
+  // Answer one scrape in the given connection.
+  void Answer(int connection);
+
+  Endpoint endpoint_{};
+  std::size_t max_process_series_{};
+  int listen_fd_{-1};
+  std::atomic<bool> stop_{false};
+  // The body served to the scrapes. A scrape keeps a reference to the body it
+  // is sending, so the renderer never changes a body in use.
+  std::mutex body_mutex_{};
+  std::shared_ptr<std::string> body_{};
+  // A body that is not referenced anymore, reused by the next render to avoid
+  // allocating a new buffer every sample.
+  std::shared_ptr<std::string> spare_body_{};
+  // Reused to choose the processes exported in each render.
+  std::vector<std::uint32_t> process_order_{};
+  std::thread server_{};
+};
+
+#endif
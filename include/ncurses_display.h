@@ -3,16 +3,85 @@
 
 #include <curses.h>
 
+#include <chrono>
+#include <limits>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "cgroup.h"
+#include "disk.h"
+#include "exit_accounting.h"
+#include "interrupts.h"
+#include "metric_scheduler.h"
 #include "process.h"
+#include "snapshot.h"
 #include "system.h"
 
 namespace NCursesDisplay {
+// What the processes view shows. The details are reduced when the monitor goes
+// over its CPU budget (see BudgetGovernor).
+struct ProcessViewOptions {
+  // Show the share of the process memory in each NUMA node. It is read only
+  // for the shown processes, and at a lower rate.
+  bool show_numa{};
+  // Show the number of sockets open by the process. They are counted only for
+  // the shown processes, and at a lower rate.
+  bool show_sockets{};
+  // Show the cgroup of the process.
+  bool show_cgroups{};
+  // Show the run queue delay and context switches columns.
+  bool show_scheduler_stats{true};
+  // Number of rows sampled in full detail. The other rows only show the
+  // metrics that don't need to read the process files.
+  int detailed_rows{std::numeric_limits<int>::max()};
+  // If not null, the RAM column shows the proportional and unique set sizes
+  // (PSS/USS) refreshed by this scheduler instead of the resident set size,
+  // and the stale values are marked.
+  const ExpensiveMetricScheduler* memory_detail{};
+  // Index of the first process shown, to scroll the view. Only the shown
+  // processes are sampled and formatted.
+  std::size_t first_row{};
+  // PID of the highlighted process, or -1 if none is.
+  int selected_pid{-1};
+};
+
 // Displays the main program UI.
 //
+// The system section is drawn before the processes are scanned, and while the
+// process list is being filled (see System::PendingProcesses) the UI refreshes
+// without waiting, so the first frame is shown as soon as possible. The time
+// to the first frame (the system section), to the first process table and to
+// the full process list are shown in the border of the process section.
+//
+// The process section takes the rest of the terminal, and it is resized with
+// it. It is a scrollable viewport over the whole list (see ProcessViewport).
+//
 // Parameters:
 //  - system: The system from which we are collecting metrics to show.
+//  - start_time: When the program started, to measure the startup times.
+void Display(System& system, std::chrono::steady_clock::time_point start_time =
+                                 std::chrono::steady_clock::now());
+
+// Displays the main program UI with the snapshots published by another
+// monitor instance, so that it doesn't read anything from "/proc". It follows
+// the publisher when it restarts, and marks the last frame as stale while there
+// is none.
+//
+// Parameters:
+//  - reader: The reader of the shared-memory snapshots.
 //  - n: The number of processes that we want to show information about.
-void Display(System& system, int n = 20);
+void Display(SnapshotReader& reader, int n = 20);
+
+// Mount both sections of the UI with the data of a published snapshot.
+//
+// Parameters:
+//  - view: The snapshot we want to show.
+//  - system_window: The window of the basic system info section.
+//  - process_window: The window of the processes detail section.
+//  - n: The number of processes that we want to show information about.
+void DisplaySnapshot(const snapshot::SnapshotView& view, WINDOW* system_window,
+                     WINDOW* process_window, int n);
 
 // Mount the basic system info section in the UI (the top part of the screen).
 //
@@ -26,15 +95,74 @@ void DisplaySystem(System& system, WINDOW* window);
 // Parameters:
 //  - processes: The set of processes that we are collecting metrics to show.
 //  - window: The window that we want mount the UI on.
-//  - n: The number of processes that we want to show information about.
-void DisplayProcesses(std::vector<Process>& processes, WINDOW* window, int n);
+//  - n: The number of processes that we want to show information about,
+//  starting from options.first_row.
+//  - sort_key: The criteria used to sort the processes, which is highlighted.
+//  - sample: The sampling context of the current tick, used to calculate the
+//  rates.
+//  - options: What the view shows.
+//  - resource: The memory resource used for the temporary allocations.
+void DisplayProcesses(
+    std::vector<Process>& processes, WINDOW* window, int n,
+    ProcessSortKey sort_key, const TickSample& sample,
+    const ProcessViewOptions& options,
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+// Mount the cgroups view in the bottom part of the screen. It replaces the
+// processes detail when the cgroups view is selected.
+//
+// Parameters:
+//  - cgroups: The groups in hierarchical order.
+//  - window: The window that we want mount the UI on.
+//  - n: The number of groups that we want to show information about.
+//  - sort_key: The criteria used to sort the groups, which is highlighted.
+void DisplayCgroups(std::vector<Cgroup>& cgroups, WINDOW* window, int n,
+                    CgroupSortKey sort_key);
+
+// Mount the block devices view in the bottom part of the screen, with the
+// busiest devices first. It replaces the processes detail when the disks view
+// is selected.
+//
+// Parameters:
+//  - disks: The monitor of the block devices, updated in the current tick.
+//  - window: The window that we want mount the UI on.
+//  - n: The number of devices that we want to show information about.
+//  - filter: Which devices are shown.
+void DisplayDisks(DiskMonitor& disks, WINDOW* window, int n,
+                  DiskFilter filter);
+
+// Mount the interrupts view in the bottom part of the screen: a heatmap of
+// the time each CPU spent handling interrupts and of the busiest interrupt
+// sources in each CPU. The sources mostly handled by a single CPU are
+// highlighted. It replaces the processes detail when the interrupts view is
+// selected.
+//
+// Parameters:
+//  - interrupts: The monitor of the interrupts, updated in the current tick.
+//  - window: The window that we want mount the UI on.
+//  - n: The number of rows of the view.
+void DisplayInterrupts(InterruptMonitor& interrupts, WINDOW* window, int n);
+
+// Mount the recently exited processes view in the bottom part of the screen,
+// with the commands that used more CPU time first. It replaces the processes
+// detail when the exited view is selected.
+//
+// Parameters:
+//  - exited_tasks: The accounting of the exited processes, updated in the
+//  current tick.
+//  - window: The window that we want mount the UI on.
+//  - n: The number of commands that we want to show information about.
+void DisplayExitedTasks(ExitAccounting& exited_tasks, WINDOW* window, int n);
 
 // Build a progress bar to attach in the UI.
 //
 // Parameters:
 //  - percent: The percent of completion of the progress bar. Should be in the
 //  interval [0, 1.0].
-std::string ProgressBar(float percent);
+//  - resource: The memory resource used to allocate the result.
+std::pmr::string ProgressBar(
+    float percent,
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 };  // namespace NCursesDisplay
 
 #endif
@@ -0,0 +1,90 @@
+#ifndef NETWORK_H
+#define NETWORK_H
+
+#include <chrono>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+// Traffic statistics of one network interface.
+struct InterfaceStats {
+  std::string name{};
+  // Cumulative counters, as reported by the kernel.
+  long long receive_bytes{};
+  long long receive_packets{};
+  long long receive_errors{};
+  long long receive_drops{};
+  long long transmit_bytes{};
+  long long transmit_packets{};
+  long long transmit_errors{};
+  long long transmit_drops{};
+  // Rates in the interval between the previous and the last update.
+  float receive_bytes_per_second{};
+  float receive_packets_per_second{};
+  float transmit_bytes_per_second{};
+  float transmit_packets_per_second{};
+  // Errors and drops of both directions.
+  float errors_per_second{};
+  float drops_per_second{};
+};
+
+// TCP statistics of the whole system.
+struct TcpStats {
+  // False if the kernel doesn't provide the statistics.
+  bool available{};
+  // Number of sockets in each state.
+  long long established{};
+  long long in_use{};
+  long long orphan{};
+  long long time_wait{};
+  // Cumulative counters, as reported by the kernel.
+  long long active_opens{};
+  long long passive_opens{};
+  long long retransmitted_segments{};
+  // Rates in the interval between the previous and the last update.
+  float active_opens_per_second{};
+  float passive_opens_per_second{};
+  float retransmitted_segments_per_second{};
+};
+
+// Reads the network statistics of the system, from "/proc/net/dev" (the
+// interfaces), "/proc/net/snmp" and "/proc/net/sockstat" (TCP).
+class NetworkMonitor {
+ public:
+  // Read the current statistics and calculate the rates in the interval since
+  // the previous update. The first update calculates the rates since the
+  // boot, and the interfaces that appear later have no rates until their
+  // second update. Consecutive calls with the same time point are ignored, so
+  // it can be called more than once in a tick.
+  //
+  // Parameters:
+  //  - now: The time point of the current tick.
+  //  - resource: The memory resource used for the temporary allocations.
+  void Update(
+      std::chrono::steady_clock::time_point now,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+  // Get the statistics of each interface, as of the last update.
+  const std::vector<InterfaceStats>& Interfaces() const;
+  // Get the TCP statistics, as of the last update.
+  const TcpStats& Tcp() const;
+
+ private:
+  void UpdateInterfaces(double elapsed_seconds, bool first_update,
+                        std::pmr::memory_resource* resource);
+  void UpdateTcp(double elapsed_seconds, std::pmr::memory_resource* resource);
+
+  std::vector<InterfaceStats> interfaces_{};
+  TcpStats tcp_{};
+  std::chrono::steady_clock::time_point last_update_{};
+};
+
+// Count the sockets open by a process, by scanning the links in
+// "/proc/<pid>/fd". The scan costs a system call per file descriptor, so it
+// should only be done for a few processes. It returns -1 if the directory
+// can't be read (e.g. processes of other users).
+//
+// Parameters:
+//  - pid: The process id.
+int CountProcessSockets(int pid);
+
+#endif
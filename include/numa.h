@@ -0,0 +1,63 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <chrono>
+#include <memory_resource>
+#include <vector>
+
+// Memory statistics of one NUMA node.
+struct NumaNodeStats {
+  // The node number, as in "/sys/devices/system/node/node<N>".
+  int node{};
+  long long total_kb{};
+  long long free_kb{};
+  // Cumulative number of pages allocated in this node for processes running
+  // in the same node (local) and in other nodes (remote).
+  long long local_allocations{};
+  long long remote_allocations{};
+  // Fraction of the pages allocated in this node, since the previous update,
+  // that were for processes running in other nodes.
+  float remote_allocation_ratio{};
+};
+
+// Reads the memory statistics of each NUMA node, from
+// "/sys/devices/system/node/node<N>/meminfo" and ".../numastat". Machines
+// without NUMA (or kernels without CONFIG_NUMA) have no nodes.
+class NumaMonitor {
+ public:
+  // Constructor. It discovers the nodes with memory.
+  NumaMonitor();
+
+  // Read the current statistics of the nodes. Consecutive calls with the same
+  // time point return the same values, so it can be called more than once in
+  // a tick.
+  //
+  // Parameters:
+  //  - now: The time point of the current tick.
+  //  - resource: The memory resource used for the temporary allocations.
+  const std::vector<NumaNodeStats>& Update(
+      std::chrono::steady_clock::time_point now,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+  // Get the number of nodes.
+  int NodeCount() const;
+
+ private:
+  std::vector<NumaNodeStats> nodes_{};
+  std::chrono::steady_clock::time_point last_update_{};
+};
+
+// Read how much memory of a process is in each NUMA node, from
+// "/proc/<pid>/numa_maps". The file walks the page tables of the process, so
+// it is expensive to read for large processes. It returns false if the file
+// can't be read.
+//
+// Parameters:
+//  - pid: The process id.
+//  - kilobytes_per_node: Receives the memory (in kB) in each node, indexed by
+//  the node number. It is resized to fit the nodes found in the file.
+//  - resource: The memory resource used for the temporary allocations.
+bool ReadNumaPlacement(int pid, std::vector<long long>& kilobytes_per_node,
+                       std::pmr::memory_resource* resource =
+                           std::pmr::get_default_resource());
+
+#endif
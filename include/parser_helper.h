@@ -1,9 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <charconv>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 namespace parser_helper {
+// Map of key-value pairs allocated from a memory resource.
+using KeyValueMap = std::pmr::unordered_map<std::pmr::string, std::pmr::string>;
+
 // Extract pairs of key-value data from a given file.
 //
 // Each line is considered a pair and the data is extracted considering the
@@ -17,10 +24,103 @@ namespace parser_helper {
 std::unordered_map<std::string, std::string> ExtractKeyValuePairsFromFile(
     const std::string& file_path, const std::string& separator);
 
+// Same as the previous function, but all the memory used by the result and the
+// file content is taken from the given memory resource.
+//
+// Parameters:
+//  - file_path: The path to the file we will read the pair values from.
+//  - separator: The string that is used to delimit key and values in the file.
+//  - resource: The memory resource used for the allocations.
+KeyValueMap ExtractKeyValuePairsFromFile(const char* file_path,
+                                         std::string_view separator,
+                                         std::pmr::memory_resource* resource);
+
 // Remove string delimiters from the provided string.
 //
 // Parameters:
 //  - value: The string that will be edited.
 void RemoveDelimiters(std::string& value);
 
+// Read the entire content of a file into the given string.
+//
+// Files under "/proc" report a size of zero, so the content is read in chunks
+// until the end of the file. It returns false if the file can't be opened,
+// which usually means that the process it describes has finished.
+//
+// Parameters:
+//  - file_path: The path to the file.
+//  - content: The string that will receive the file content.
+bool TryReadFile(const char* file_path, std::pmr::string& content);
+
+// Read the entire content of a file, throwing an OpenFileError if the file
+// can't be opened.
+//
+// Parameters:
+//  - file_path: The path to the file.
+//  - resource: The memory resource used to allocate the content.
+std::pmr::string ReadFile(const char* file_path,
+                          std::pmr::memory_resource* resource);
+
+// Build the path "/proc/<pid>/<file_name>".
+//
+// Parameters:
+//  - pid: The process id.
+//  - file_name: The name of the file inside the process directory.
+//  - resource: The memory resource used to allocate the path.
+std::pmr::string ProcessFilePath(int pid, std::string_view file_name,
+                                 std::pmr::memory_resource* resource);
+
+// Splits a text in fields delimited by whitespace without copying it.
+//
+// All the returned fields are views into the original text, so the text must
+// outlive the tokenizer and the fields.
+class FieldTokenizer {
+ public:
+  explicit FieldTokenizer(std::string_view text) : text_{text} {}
+
+  // Get the next field, or an empty view if there are no more fields in the
+  // text.
+  std::string_view Next();
+  // Ignore the next count fields.
+  void Skip(int count);
+  // Parse the next field as an integer. It returns the fallback value if the
+  // field is missing or is not a number.
+  template <typename T>
+  T NextNumber(T fallback = T{}) {
+    const std::string_view field{Next()};
+    T value{};
+    const auto result =
+        std::from_chars(field.data(), field.data() + field.size(), value);
+    return result.ec == std::errc{} ? value : fallback;
+  }
+  // Get the text that was not consumed yet.
+  std::string_view Remaining() const { return text_; }
+
+ private:
+  std::string_view text_{};
+};
+
+// Find the value associated with a key in the content of a file that has one
+// "<key><separator><value>" pair per line. The value has the leading
+// whitespace removed. It returns an empty view if the key is not found.
+//
+// Parameters:
+//  - content: The file content.
+//  - key: The key we are looking for, including the separator (e.g. "VmRSS:").
+std::string_view FindValue(std::string_view content, std::string_view key);
+
+// Call a function with each line of a text, without the line break.
+//
+// Parameters:
+//  - content: The text.
+//  - function: A callable that receives each line as a std::string_view.
+template <typename Function>
+void ForEachLine(std::string_view content, Function&& function) {
+  while (!content.empty()) {
+    const std::size_t line_end{std::min(content.find('\n'), content.size())};
+    function(content.substr(0, line_end));
+    content.remove_prefix(std::min(line_end + 1, content.size()));
+  }
+}
+
 }  // namespace parser_helper
@@ -0,0 +1,102 @@
+#ifndef PRESSURE_H
+#define PRESSURE_H
+
+#include <array>
+#include <chrono>
+#include <memory_resource>
+#include <string_view>
+
+// Resources with Pressure Stall Information (PSI).
+enum class PressureResource { kCpu, kMemory, kIo };
+
+// Pressure Stall Information of one resource. The averages are the percentage
+// of time, in the last 10, 60 and 300 seconds, in which some (or all) of the
+// non-idle tasks were stalled waiting for the resource.
+struct PressureStats {
+  // False if the kernel doesn't provide the information.
+  bool available{};
+  float some_avg10{};
+  float some_avg60{};
+  float some_avg300{};
+  float full_avg10{};
+  float full_avg60{};
+  float full_avg300{};
+  // Total stall time in microseconds.
+  long long some_total_us{};
+  long long full_total_us{};
+};
+
+// Parse the content of a PSI file, that has the format:
+//   some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+//   full avg10=0.00 avg60=0.00 avg300=0.00 total=0
+//
+// Parameters:
+//  - content: The file content.
+PressureStats ParsePressure(std::string_view content);
+
+// Reads the system wide Pressure Stall Information, in "/proc/pressure/", and
+// controls the refresh rate of the monitor based on it.
+//
+// PSI triggers are registered in the memory and io files. The kernel notifies
+// them (through poll()) when the stall time in a time window crosses a
+// threshold. When it happens the monitor refreshes at a faster rate for a
+// bounded period, so we get fine grained data during an incident without
+// paying for it the rest of the time.
+class PressureMonitor {
+ public:
+  // Result of waiting for the next refresh.
+  struct WaitResult {
+    // There is data available in the input file descriptor.
+    bool input_ready{};
+    // A stall threshold was crossed while waiting.
+    bool stalled{};
+  };
+
+  // Constructor. It registers the PSI triggers, if the kernel supports them.
+  //
+  // Parameters:
+  //  - stall_threshold: The stall time in the trigger window that starts the
+  //  fast capture.
+  //  - trigger_window: The time window of the triggers. Unprivileged users
+  //  can only use multiples of 2 seconds.
+  //  - capture_duration: For how long the fast capture lasts after a trigger.
+  explicit PressureMonitor(
+      std::chrono::microseconds stall_threshold =
+          std::chrono::milliseconds{200},
+      std::chrono::microseconds trigger_window = std::chrono::seconds{2},
+      std::chrono::milliseconds capture_duration = std::chrono::seconds{10});
+  PressureMonitor(const PressureMonitor&) = delete;
+  PressureMonitor& operator=(const PressureMonitor&) = delete;
+  ~PressureMonitor();
+
+  // Read the current stall information of a resource.
+  //
+  // Parameters:
+  //  - pressure_resource: The resource we want the information about.
+  //  - resource: The memory resource used for the temporary allocations.
+  PressureStats Read(PressureResource pressure_resource,
+                     std::pmr::memory_resource* resource =
+                         std::pmr::get_default_resource()) const;
+  // Check if the triggers were registered.
+  bool HasTriggers() const;
+  // Check if the monitor is refreshing at the faster rate.
+  bool FastCaptureActive() const;
+  // Get the time until the next refresh, which depends on the fast capture.
+  std::chrono::milliseconds RefreshInterval() const;
+  // Wait until the next refresh, a stall notification or data in the input.
+  // A stall notification starts (or extends) the fast capture.
+  //
+  // Parameters:
+  //  - input_fd: A file descriptor to watch for input (e.g. the terminal), or
+  //  -1 to ignore the input.
+  //  - slowdown: The refresh interval is multiplied by this factor.
+  WaitResult Wait(int input_fd, int slowdown = 1);
+
+ private:
+  // The file descriptors of the registered triggers, or -1.
+  std::array<int, 2> trigger_fds_{-1, -1};
+  std::chrono::milliseconds capture_duration_{};
+  std::chrono::steady_clock::time_point fast_capture_until_{};
+};
+
+#endif
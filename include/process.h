@@ -2,10 +2,17 @@
 #define PROCESS_H
 
 #include <chrono>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include <vector>
 
+#include "processor.h"
 #include "uid_resolver.h"
 
+// Criteria that can be used to sort the processes view.
+enum class ProcessSortKey { kUser, kRunQueueDelay, kContextSwitches };
+
 // Represent a system running process. You can use it to retrieve some metrics
 // related to the process.
 class Process {
@@ -17,25 +24,172 @@ class Process {
   //  - boot_time: The system boot time.
   //  - uid_resolver: It is used to retrieve the name of the user running this
   //  process.
+  //  - resource: The memory resource used for the temporary allocations made
+  //  while reading the process files.
   explicit Process(const int pid,
                    const std::chrono::system_clock::time_point boot_time,
-                   UidResolver* uid_resolver);
+                   UidResolver* uid_resolver,
+                   std::pmr::memory_resource* resource =
+                       std::pmr::get_default_resource());
 
   // Get the process PID.
   int Pid() const;
+  // Get the id of the user that is running this process.
+  int Uid() const;
   // Get the the user name that is running this process.
-  std::string User() const;
-  // Get the command line used to start this process.
-  std::string Command() const;
+  const std::string& User() const;
+  // Get the command line used to start this process. It is read the first
+  // time it is needed, so the views only read it for the processes they show.
+  //
+  // Parameters:
+  //  - resource: The memory resource used for the temporary allocations.
+  const std::string& Command(
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      const;
+  // Get the path of the cgroup (v2) this process belongs to, relative to the
+  // cgroup hierarchy root. It is read once, when the process is discovered.
+  const std::string& CgroupPath() const;
   // Get the process CPU utilization in percent and in the interval [0, 1.0].
-  // The first time it is called, it returns the average use of CPU for the
+  // It is relative to the time of all CPUs, like the system utilization, so
+  // the utilization of all processes adds up to the one of the system. The
+  // first time it is called, it returns the average use of CPU for the
   // lifetime of the process so far. Consecutive calls will calculate the usage
-  // of CPU in the interval of the last and current call.
-  float CpuUtilization();
+  // of CPU in the interval between the previous and the given tick, and calls
+  // with the same tick return the same value.
+  //
+  // Parameters:
+  //  - sample: The sampling context of the current tick.
+  //  - resource: The memory resource used for the temporary allocations.
+  float CpuUtilization(
+      const TickSample& sample,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+  // Calculate the CPU utilization of the tick from the content of the
+  // "/proc/<pid>/stat" file, read by the caller. The next CpuUtilization calls
+  // in the same tick return the calculated value. An empty content (the file
+  // could not be read) gives no utilization.
+  //
+  // Parameters:
+  //  - sample: The sampling context of the current tick.
+  //  - stat_content: The content of the process stat file.
+  void UpdateCpuUtilization(const TickSample& sample,
+                            std::string_view stat_content);
+  // Get when the CPU utilization was last calculated, or the epoch if it never
+  // was.
+  std::chrono::steady_clock::time_point CpuSampledAt() const;
   // Get the amount of RAM allocated by this process in megabytes.
-  std::string Ram();
+  //
+  // Parameters:
+  //  - resource: The memory resource used for the temporary allocations.
+  std::string Ram(
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+  // Get the amount of RAM allocated by this process in kilobytes, or -1 if it
+  // is not available.
+  //
+  // Parameters:
+  //  - resource: The memory resource used for the temporary allocations.
+  long RamKilobytes(
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+  // Get the amount of RAM allocated by this process in kilobytes from the
+  // content of the "/proc/<pid>/status" file, read by the caller. It is -1 if
+  // it is not available.
+  //
+  // Parameters:
+  //  - status_content: The content of the process status file.
+  long RamKilobytes(std::string_view status_content) const;
+  // Read the proportional and unique set sizes of the process from
+  // "/proc/<pid>/smaps_rollup". The kernel walks every memory mapping of the
+  // process to produce the file, so it is expensive to read and it should be
+  // scheduled (see ExpensiveMetricScheduler). It returns false if the file
+  // can't be read, e.g. for kernel threads.
+  //
+  // Parameters:
+  //  - now: The time point of the current tick, stored as the sample time.
+  //  - resource: The memory resource used for the temporary allocations.
+  bool UpdateMemoryDetail(
+      std::chrono::steady_clock::time_point now,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+  // Get the proportional set size (PSS) in kilobytes, i.e. the private memory
+  // plus a proportional share of the memory shared with other processes, as
+  // of the last UpdateMemoryDetail. It is -1 if it was never read.
+  long long PssKilobytes() const;
+  // Get the unique set size (USS) in kilobytes, i.e. the memory that is only
+  // used by this process, as of the last UpdateMemoryDetail. It is -1 if it
+  // was never read.
+  long long UssKilobytes() const;
+  // Get when the memory detail was last read, or the epoch if it never was.
+  std::chrono::steady_clock::time_point MemoryDetailSampledAt() const;
   // Get the time in which this process has been running, in seconds.
   long int UpTime() const;
+  // Sample the scheduler statistics of the process and calculate their rates
+  // in the interval since the previous sample. Consecutive calls with the same
+  // time point are ignored, so it can be called more than once in a tick.
+  //
+  // The values are read from "/proc/<pid>/schedstat" and "/proc/<pid>/status",
+  // which describe the main thread of the process.
+  //
+  // Parameters:
+  //  - now: The time point of the current tick.
+  //  - resource: The memory resource used for the temporary allocations.
+  void UpdateSchedulerStats(
+      std::chrono::steady_clock::time_point now,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+  // Sample the scheduler statistics of the process from the content of its
+  // "/proc/<pid>/schedstat" and "/proc/<pid>/status" files, read by the
+  // caller. An empty schedstat content means the files couldn't be read, and
+  // the previous values are kept.
+  //
+  // Parameters:
+  //  - now: The time point of the current tick.
+  //  - schedstat_content: The content of the process schedstat file.
+  //  - status_content: The content of the process status file.
+  void UpdateSchedulerStats(std::chrono::steady_clock::time_point now,
+                            std::string_view schedstat_content,
+                            std::string_view status_content);
+  // Get when the scheduler statistics were last sampled, or the epoch if they
+  // never were.
+  std::chrono::steady_clock::time_point SchedulerStatsSampledAt() const;
+  // Get the fraction of time, in the interval [0, 1.0], the process was ready
+  // to run but waiting in a run queue for a CPU. High values mean that the
+  // process is being starved.
+  float RunQueueDelay() const;
+  // Get the number of times per second the process ran on a CPU.
+  float TimeslicesPerSecond() const;
+  // Get the number of times per second the process gave up the CPU, usually
+  // to wait for a resource.
+  float VoluntaryContextSwitchesPerSecond() const;
+  // Get the number of times per second the process was preempted.
+  float InvoluntaryContextSwitchesPerSecond() const;
+  // Read how much of the process memory is in each NUMA node, if the last
+  // reading is older than the maximum age. Reading "/proc/<pid>/numa_maps" is
+  // expensive, so it should only be done for a few processes (e.g. the visible
+  // ones) and at a lower rate than the other metrics.
+  //
+  // Parameters:
+  //  - now: The time point of the current tick.
+  //  - max_age: The maximum age of the last reading.
+  //  - resource: The memory resource used for the temporary allocations.
+  void UpdateNumaPlacement(
+      std::chrono::steady_clock::time_point now,
+      std::chrono::milliseconds max_age,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+  // Get the memory (in kB) of the process in each NUMA node, indexed by the
+  // node number, as of the last UpdateNumaPlacement reading. It is empty if
+  // the placement was never read.
+  const std::vector<long long>& NumaKilobytes() const;
+  // Count the sockets open by the process, if the last count is older than the
+  // maximum age. Scanning "/proc/<pid>/fd" is expensive for processes with
+  // many open files, so it should only be done for a few processes (e.g. the
+  // visible ones) and at a lower rate than the other metrics.
+  //
+  // Parameters:
+  //  - now: The time point of the current tick.
+  //  - max_age: The maximum age of the last count.
+  void UpdateSocketCount(std::chrono::steady_clock::time_point now,
+                         std::chrono::milliseconds max_age);
+  // Get the number of sockets open by the process, as of the last
+  // UpdateSocketCount. It is -1 if it was never counted or the process files
+  // are not accessible.
+  int SocketCount() const;
   // Sort the process by UID and PID.
   bool operator<(Process const& a) const;
 
@@ -43,14 +197,42 @@ class Process {
   int pid_{};
   std::chrono::system_clock::time_point boot_time_{};
   std::chrono::system_clock::time_point process_start_time_{};
-  std::string command_line_{};
+  // The command line is read lazily, so it is mutable.
+  mutable std::string command_line_{};
+  mutable bool command_line_read_{};
+  std::string cgroup_path_{};
   int uid_{};
   // Stores the name of the user that is running this process.
   std::string username_{};
-  // Stores the last time we checked for CPU utilization.
-  std::chrono::system_clock::time_point last_cpu_utilization_check_{};
-  // Stores the last value of time spent in CPU in milliseconds.
-  long last_cpu_time_spent_ms_{};
+  // Stores the tick of the last CPU utilization calculation and its result.
+  std::chrono::steady_clock::time_point last_cpu_sample_{};
+  float cpu_utilization_{};
+  // Stores the CPU time of the system and of the process, in clock ticks, in
+  // the last CPU utilization calculation.
+  long long last_system_cpu_ticks_{};
+  long long last_cpu_ticks_{};
+  // Stores the last time we sampled the scheduler statistics.
+  std::chrono::steady_clock::time_point last_scheduler_sample_{};
+  // Stores the last cumulative scheduler counters.
+  long long last_run_queue_wait_ns_{};
+  long long last_timeslices_{};
+  long long last_voluntary_context_switches_{};
+  long long last_involuntary_context_switches_{};
+  // Rates calculated in the last scheduler sample.
+  float run_queue_delay_{};
+  float timeslices_per_second_{};
+  float voluntary_context_switches_per_second_{};
+  float involuntary_context_switches_per_second_{};
+  // Stores the memory detail and when it was read.
+  long long pss_kilobytes_{-1};
+  long long uss_kilobytes_{-1};
+  std::chrono::steady_clock::time_point memory_detail_sampled_at_{};
+  // Stores the number of open sockets and when it was counted.
+  int socket_count_{-1};
+  std::chrono::steady_clock::time_point socket_count_sampled_at_{};
+  // Stores the memory per NUMA node and when it was read.
+  std::vector<long long> numa_kilobytes_{};
+  std::chrono::steady_clock::time_point numa_sampled_at_{};
 };
 
 #endif
@@ -0,0 +1,267 @@
+#ifndef PROCESS_COLUMNS_H
+#define PROCESS_COLUMNS_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "metric_scheduler.h"
+#include "process.h"
+#include "processor.h"
+
+// The columns of the processes view. Each column is a type that declares the
+// process files it reads, how its cells are formatted and, if it can be used
+// to sort the view, how the processes are compared. A view is a ColumnSet of
+// the columns it shows, so the sampling, sorting and rendering code of each
+// set is fixed at compile time, and the columns that are not shown cost
+// nothing. The files are read lazily, once per row, by the first column that
+// needs them (see ProcessFiles).
+namespace process_columns {
+
+// The files in "/proc/<pid>" read by the columns, as bit flags.
+enum ProcessFile : unsigned {
+  kNoFile = 0,
+  kStatFile = 1U << 0,
+  kStatusFile = 1U << 1,
+  kSchedstatFile = 1U << 2,
+  kSmapsRollupFile = 1U << 3,
+  kNumaMapsFile = 1U << 4,
+  kFdDirectory = 1U << 5,
+};
+
+// The content of the small files of a process, read at most once while a row
+// is sampled, so the columns that use the same file share the read.
+class ProcessFiles {
+ public:
+  // Constructor.
+  //
+  // Parameters:
+  //  - pid: The process id.
+  //  - resource: The memory resource used to store the contents.
+  ProcessFiles(int pid, std::pmr::memory_resource* resource);
+  // Get the content of a file, reading it the first time. It is empty if the
+  // file can't be read.
+  //
+  // Parameters:
+  //  - file: One of kStatFile, kStatusFile and kSchedstatFile. The other files
+  //  are read by the process, at their own rate.
+  std::string_view Get(ProcessFile file);
+
+ private:
+  int pid_{};
+  std::array<std::pmr::string, 3> contents_;
+  std::array<bool, 3> read_{};
+};
+
+// What the columns use to sample and format a row.
+struct ColumnContext {
+  // The sampling context of the current tick.
+  const TickSample& sample;
+  // The files of the process in the row.
+  ProcessFiles& files;
+  // The memory resource used for the temporary allocations.
+  std::pmr::memory_resource* resource{};
+  // The scheduler that refreshes the memory detail, if it is shown.
+  const ExpensiveMetricScheduler* memory_detail{};
+  // Storage for the formatted cells.
+  std::array<char, 32> buffer{};
+  // Set by the columns when the cell has an old value, to dim it.
+  bool stale{};
+};
+
+// The defaults of the column declarations. A column has:
+//  - kTitle: The header of the column.
+//  - kWidth: The width of the column, including the separator. A zero width
+//  takes the rest of the row.
+//  - kFiles: The files the column reads. The columns that read no files are
+//  always shown, while the others are only sampled for the detailed rows.
+//  - kSortable and kSortKey: If the view can be sorted by the column, and the
+//  sort key that selects it.
+//  - Update(): Samples the column values of a process.
+//  - Format(): Formats the cell of a process, after Update().
+//  - Less(): Compares two processes, after Update(), if it is sortable.
+struct Column {
+  static constexpr unsigned kFiles{kNoFile};
+  static constexpr bool kSortable{false};
+  static constexpr ProcessSortKey kSortKey{ProcessSortKey::kUser};
+  static void Update(Process&, ColumnContext&) {}
+};
+
+// The processes are not sorted by PID: the default order (kUser) is sorted by
+// user and then by PID, and it is selected by the UserColumn.
+struct PidColumn : Column {
+  static constexpr const char* kTitle{"PID"};
+  static constexpr int kWidth{7};
+  static std::string_view Format(Process& process, ColumnContext& context);
+};
+
+struct UserColumn : Column {
+  static constexpr const char* kTitle{"USER"};
+  static constexpr int kWidth{11};
+  static constexpr bool kSortable{true};
+  static std::string_view Format(Process& process, ColumnContext& context);
+  static bool Less(const Process& a, const Process& b);
+};
+
+struct CpuColumn : Column {
+  static constexpr const char* kTitle{"CPU[%]"};
+  static constexpr int kWidth{10};
+  static constexpr unsigned kFiles{kStatFile};
+  static void Update(Process& process, ColumnContext& context);
+  static std::string_view Format(Process& process, ColumnContext& context);
+};
+
+struct RamColumn : Column {
+  static constexpr const char* kTitle{"RAM[MB]"};
+  static constexpr int kWidth{9};
+  static constexpr unsigned kFiles{kStatusFile};
+  static std::string_view Format(Process& process, ColumnContext& context);
+};
+
+// The proportional and unique set sizes, refreshed by the
+// ExpensiveMetricScheduler instead of the view.
+struct PssUssColumn : Column {
+  static constexpr const char* kTitle{"PSS/USS"};
+  static constexpr int kWidth{9};
+  static constexpr unsigned kFiles{kSmapsRollupFile};
+  static std::string_view Format(Process& process, ColumnContext& context);
+};
+
+struct TimeColumn : Column {
+  static constexpr const char* kTitle{"TIME+"};
+  static constexpr int kWidth{11};
+  static std::string_view Format(Process& process, ColumnContext& context);
+};
+
+struct RunQueueDelayColumn : Column {
+  static constexpr const char* kTitle{"WAIT[%]"};
+  static constexpr int kWidth{9};
+  static constexpr unsigned kFiles{kSchedstatFile | kStatusFile};
+  static constexpr bool kSortable{true};
+  static constexpr ProcessSortKey kSortKey{ProcessSortKey::kRunQueueDelay};
+  static void Update(Process& process, ColumnContext& context);
+  static std::string_view Format(Process& process, ColumnContext& context);
+  static bool Less(const Process& a, const Process& b);
+};
+
+// The voluntary/involuntary context switches per second.
+struct ContextSwitchesColumn : Column {
+  static constexpr const char* kTitle{"CSW/s"};
+  static constexpr int kWidth{11};
+  static constexpr unsigned kFiles{kSchedstatFile | kStatusFile};
+  static constexpr bool kSortable{true};
+  static constexpr ProcessSortKey kSortKey{ProcessSortKey::kContextSwitches};
+  static void Update(Process& process, ColumnContext& context);
+  static std::string_view Format(Process& process, ColumnContext& context);
+  static bool Less(const Process& a, const Process& b);
+};
+
+// The share of the process memory in each NUMA node, e.g. "75/25" in a two
+// nodes machine.
+struct NumaColumn : Column {
+  static constexpr const char* kTitle{"NUMA[%]"};
+  static constexpr int kWidth{16};
+  static constexpr unsigned kFiles{kNumaMapsFile};
+  static void Update(Process& process, ColumnContext& context);
+  static std::string_view Format(Process& process, ColumnContext& context);
+};
+
+struct SocketsColumn : Column {
+  static constexpr const char* kTitle{"SOCK"};
+  static constexpr int kWidth{7};
+  static constexpr unsigned kFiles{kFdDirectory};
+  static void Update(Process& process, ColumnContext& context);
+  static std::string_view Format(Process& process, ColumnContext& context);
+};
+
+// The cgroup of the process, read once when the process is discovered. The
+// start of the long paths is cut, since the last components identify the
+// group (e.g. the service or the container).
+struct CgroupColumn : Column {
+  static constexpr const char* kTitle{"CGROUP"};
+  static constexpr int kWidth{25};
+  static std::string_view Format(Process& process, ColumnContext& context);
+};
+
+struct CommandColumn : Column {
+  static constexpr const char* kTitle{"COMMAND"};
+  static constexpr int kWidth{0};
+  static std::string_view Format(Process& process, ColumnContext& context);
+};
+
+// A list of columns, in the order they are shown.
+template <typename... Columns>
+struct ColumnSet {
+  // The set with more columns at the end.
+  template <typename... More>
+  using Append = ColumnSet<Columns..., More...>;
+
+  // Call a function for each column, in order, with an instance of the column
+  // type and the offset of the column.
+  //
+  // Parameters:
+  //  - first_offset: The offset of the first column.
+  //  - function: The function called as function(column, offset).
+  template <typename Function>
+  static void ForEach(int first_offset, Function&& function) {
+    int offset{first_offset};
+    (function(Columns{}, std::exchange(offset, offset + Columns::kWidth)),
+     ...);
+  }
+
+  // Sort the processes by the column with the given key, sampling the column
+  // for all of them. The processes with the same value are kept in the default
+  // order, and the list is not changed if no column of the set has the key.
+  // The default order is the user order (see System::Processes), so nothing is
+  // sampled for the kUser key.
+  //
+  // Parameters:
+  //  - processes: The processes, in the default order.
+  //  - sort_key: The criteria used to sort the processes.
+  //  - sample: The sampling context of the current tick.
+  //  - resource: The memory resource used for the temporary allocations.
+  static void Sort(std::vector<Process>& processes, ProcessSortKey sort_key,
+                   const TickSample& sample,
+                   std::pmr::memory_resource* resource) {
+    if (sort_key == ProcessSortKey::kUser) {
+      return;
+    }
+    bool sorted{false};
+    ForEach(0, [&](auto column, int) {
+      using SortColumn = decltype(column);
+      if constexpr (SortColumn::kSortable) {
+        if (sorted || SortColumn::kSortKey != sort_key) {
+          return;
+        }
+        sorted = true;
+        for (Process& process : processes) {
+          ProcessFiles files{process.Pid(), resource};
+          ColumnContext context{sample, files, resource};
+          SortColumn::Update(process, context);
+        }
+        std::sort(processes.begin(), processes.end(),
+                  [](const Process& a, const Process& b) {
+                    if (SortColumn::Less(a, b)) {
+                      return true;
+                    }
+                    return !SortColumn::Less(b, a) && a < b;
+                  });
+      }
+    });
+  }
+};
+
+// Every column, used to sort the processes no matter which ones are shown.
+using AllColumns =
+    ColumnSet<PidColumn, UserColumn, CpuColumn, RamColumn, PssUssColumn,
+              TimeColumn, RunQueueDelayColumn, ContextSwitchesColumn,
+              NumaColumn, SocketsColumn, CgroupColumn, CommandColumn>;
+
+}  // namespace process_columns
+
+#endif
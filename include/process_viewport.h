@@ -0,0 +1,66 @@
+#ifndef PROCESS_VIEWPORT_H
+#define PROCESS_VIEWPORT_H
+
+#include <cstddef>
+#include <vector>
+
+#include "process.h"
+
+// The part of the process list shown by a view, and the selected process. The
+// selection is tracked by PID, so the selected process stays in view when the
+// list is refreshed or sorted again. The moves are applied by the next
+// Update(), when the list of the tick is known.
+class ProcessViewport {
+ public:
+  // Set the number of visible rows.
+  //
+  // Parameters:
+  //  - rows: The number of rows, at least one.
+  void Resize(int rows);
+  // Get the number of visible rows.
+  int Rows() const;
+  // Move the selection by some rows, up if negative.
+  //
+  // Parameters:
+  //  - rows: The number of rows.
+  void Move(int rows);
+  // Move the selection a page up.
+  void PageUp();
+  // Move the selection a page down.
+  void PageDown();
+  // Select the first process of the list.
+  void Home();
+  // Select the last process of the list.
+  void End();
+  // Select a process by its PID. If it is not in the list, the selection
+  // doesn't change.
+  //
+  // Parameters:
+  //  - pid: The process id.
+  void SelectPid(int pid);
+  // Apply the pending moves and scroll the viewport, so that the selected
+  // process is visible.
+  //
+  // Parameters:
+  //  - processes: The process list of the tick, in the order it is shown.
+  void Update(const std::vector<Process>& processes);
+  // Get the index of the first visible process.
+  std::size_t First() const;
+  // Get the index of the selected process.
+  std::size_t SelectedIndex() const;
+  // Get the PID of the selected process, or -1 if none was selected yet.
+  int SelectedPid() const;
+
+ private:
+  int rows_{1};
+  std::size_t first_{};
+  std::size_t selected_index_{};
+  int selected_pid_{-1};
+  // The PID selected with SelectPid(), or -1 if there is none.
+  int requested_pid_{-1};
+  // The rows the selection moves in the next update. The Home() and End()
+  // moves are larger than any list.
+  long long pending_move_{};
+};
+
+#endif
@@ -1,22 +1,93 @@
 #ifndef PROCESSOR_H
 #define PROCESSOR_H
 
+#include <chrono>
+#include <memory_resource>
+
+// Run queue statistics of the whole system.
+struct RunQueueStats {
+  // False if the kernel doesn't provide the statistics.
+  bool available{};
+  // Time the tasks spent waiting for a CPU, relative to the total CPU time
+  // available. For example, 0.1 means that in a 4 CPUs system the tasks waited
+  // 0.4 seconds in run queues in each second.
+  float delay{};
+  // Average time a task waited in a run queue before each timeslice, in
+  // milliseconds.
+  float delay_per_timeslice_ms{};
+};
+
+// Cumulative CPU times of the whole system, read from "/proc/stat". The times
+// are the sums of all CPUs, expressed in USER_HZ (clock ticks, also known as
+// jiffies).
+struct CpuTimes {
+  // Time the CPUs were either active or idle.
+  long long total{};
+  // Time the CPUs were idle, including the time waiting for IO.
+  long long idle{};
+  // Number of CPUs accounted in the times.
+  int cpu_count{};
+};
+
+// Sampling context of a tick. It is taken once per tick and every rate
+// calculated in the tick uses it as the common baseline, so the values are
+// consistent with each other (e.g. the CPU utilization of the processes adds
+// up to the CPU utilization of the system).
+struct TickSample {
+  // When the tick started, in the monotonic clock, so it is not affected by
+  // changes in the system time.
+  std::chrono::steady_clock::time_point time{};
+  // The CPU times at the start of the tick.
+  CpuTimes cpu{};
+};
+
 // Represent the processor in the machine. You can use it to retrieve some
 // metrics.
 class Processor {
  public:
+  // Read the current CPU times from "/proc/stat".
+  //
+  // Parameters:
+  //  - resource: The memory resource used for the temporary allocations.
+  CpuTimes Times(
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      const;
   // Calculate the CPU utilization in percent and in the interval [0, 1.0].
   // For multicore machines (that it is the usual nowadays) it consider the
   // average use of all cores. The first call returns the average use of CPU for
   // entire machine uptime. Consecutive calls will calculate the usage
-  // considering the interval between the last and current call.
-  float Utilization();
+  // considering the interval between the previous and the given tick, and
+  // calls with the same tick return the same value.
+  //
+  // Parameters:
+  //  - sample: The sampling context of the current tick.
+  float Utilization(const TickSample& sample);
+  // Calculate the run queue statistics, from the counters in "/proc/schedstat".
+  // The first call returns the statistics for the entire machine uptime.
+  // Consecutive calls will consider the interval between the previous and the
+  // given tick, and calls with the same tick return the same statistics.
+  //
+  // Parameters:
+  //  - sample: The sampling context of the current tick.
+  //  - resource: The memory resource used for the temporary allocations.
+  RunQueueStats RunQueueDelay(
+      const TickSample& sample,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
  private:
-  // Stores the previous total time of CPU available in the system.
-  long previous_total_time_{};
-  // Stores the previous CPU idle time in the system.
-  long previous_idle_time_{};
+  // Stores the CPU times of the previous tick.
+  CpuTimes previous_times_{};
+  // Stores the tick of the last utilization calculation and its result.
+  std::chrono::steady_clock::time_point last_utilization_tick_{};
+  float utilization_{};
+  // Stores the previous sum of the run queue delays of all CPUs.
+  long long previous_run_delay_ns_{};
+  // Stores the previous sum of the timeslices of all CPUs.
+  long long previous_timeslices_{};
+  // Stores the last time we calculated the run queue statistics and their
+  // result.
+  std::chrono::steady_clock::time_point previous_run_queue_check_{};
+  RunQueueStats run_queue_stats_{};
 };
 
 #endif
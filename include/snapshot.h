@@ -0,0 +1,199 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Layout of the shared-memory snapshots published by the monitor.
+//
+// A publisher samples "/proc" once per tick and writes the result into a ring
+// of slots in a file under "/dev/shm". Any number of readers (other monitor
+// instances, metrics agents, scripts) map the same file and read the latest
+// slot in place, so they don't add any load to "/proc".
+//
+// The file starts with a Header, followed by slot_count slots of slot_size
+// bytes. Each slot is a SlotHeader followed by process_capacity ProcessRecords.
+// Every slot is protected by a sequence lock: the publisher makes the sequence
+// odd while it writes the slot and even again when it is done, so a reader
+// knows the data it read is consistent if the sequence was the same even
+// number before and after reading it.
+//
+// The reader and this header are built as the monitor_snapshot library, so
+// other tools can read the snapshots without the rest of the monitor.
+namespace snapshot {
+constexpr std::uint32_t kMagic{0x534e4f4d};  // "MONS"
+constexpr std::uint32_t kVersion{1};
+constexpr std::uint32_t kSlotCount{4};
+constexpr const char* kDefaultPath{"/dev/shm/monitor-snapshot"};
+
+struct SystemRecord {
+  float cpu_utilization;
+  float memory_utilization;
+  std::int32_t total_processes;
+  std::int32_t running_processes;
+  std::int64_t uptime_seconds;
+  char operating_system[64];
+  char kernel[64];
+};
+
+struct ProcessRecord {
+  std::int32_t pid;
+  std::int32_t uid;
+  float cpu_utilization;
+  std::int64_t ram_kb;
+  std::int64_t uptime_seconds;
+  char user[32];
+  char command[256];
+};
+
+struct SlotHeader {
+  std::atomic<std::uint64_t> sequence;
+  // Number of the tick that produced this snapshot.
+  std::uint64_t tick;
+  // Time the snapshot was taken, in nanoseconds since the epoch.
+  std::int64_t timestamp_ns;
+  SystemRecord system;
+  // Number of valid records after the header.
+  std::uint32_t process_count;
+  // Number of processes that did not fit in the slot.
+  std::uint32_t dropped_processes;
+};
+
+struct Header {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t slot_count;
+  std::uint32_t process_capacity;
+  std::uint64_t slot_size;
+  // Number of snapshots published so far. The latest one is in the slot
+  // (published - 1) % slot_count.
+  std::atomic<std::uint64_t> published;
+};
+
+// Get the size of a slot with room for the given number of processes.
+constexpr std::size_t SlotSize(std::uint32_t process_capacity) {
+  return sizeof(SlotHeader) + process_capacity * sizeof(ProcessRecord);
+}
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "The sequence lock needs lock free atomics to work between "
+              "processes.");
+
+// Get a view of a fixed size string field, which may not be null terminated.
+template <std::size_t N>
+std::string_view FieldView(const char (&field)[N]) {
+  return std::string_view{field, strnlen(field, N)};
+}
+
+// A read-only view of one snapshot in the shared memory. The data is not
+// copied, so it is only guaranteed to be consistent after the read that
+// produced the view is validated (see SnapshotReader::Read).
+class SnapshotView {
+ public:
+  explicit SnapshotView(const SlotHeader* slot) : slot_{slot} {}
+
+  const SlotHeader& Slot() const { return *slot_; }
+  const SystemRecord& System() const { return slot_->system; }
+  std::uint32_t ProcessCount() const { return slot_->process_count; }
+  const ProcessRecord* Processes() const {
+    return reinterpret_cast<const ProcessRecord*>(slot_ + 1);
+  }
+
+ private:
+  const SlotHeader* slot_{};
+};
+}  // namespace snapshot
+
+// Reads the snapshots published by a SnapshotPublisher.
+//
+// A publisher that restarts replaces the file instead of reusing it, so the
+// reader keeps mapping the file of the old one until Refresh is called.
+class SnapshotReader {
+ public:
+  // Constructor. It maps the shared-memory file and throws an OpenFileError if
+  // it doesn't exist or an UnexpectedFormatError if it was not created by a
+  // compatible publisher (see errors.h; both are std::exceptions).
+  //
+  // Parameters:
+  //  - path: The path of the shared-memory file.
+  explicit SnapshotReader(const std::string& path = snapshot::kDefaultPath);
+  SnapshotReader(const SnapshotReader&) = delete;
+  SnapshotReader& operator=(const SnapshotReader&) = delete;
+  ~SnapshotReader();
+
+  // Get the number of snapshots published so far.
+  std::uint64_t Published() const;
+  // Check if the publisher replaced the file (i.e. it was restarted) and map
+  // the new one if so, and note whether a new snapshot was published since the
+  // previous call. It doesn't throw: if the new file can't be mapped yet (e.g.
+  // the publisher is still creating it), the old one is kept and it is tried
+  // again in the next call.
+  //
+  // Parameters:
+  //  - now: The time point of the call.
+  void Refresh(std::chrono::steady_clock::time_point now =
+                   std::chrono::steady_clock::now());
+  // Check if the latest snapshot is out of date, because the file was removed
+  // or replaced by one we could not map, or nothing was published in the last
+  // seconds (e.g. the publisher was killed). It is updated by Refresh.
+  bool Stale() const;
+
+  // Call the visitor with a view of the latest snapshot, without copying it.
+  //
+  // The publisher may overwrite the slot while the visitor is running, in which
+  // case the visitor is called again with the newest snapshot. So the visitor
+  // must not trust the data it read until Read returns true, and must tolerate
+  // torn values (e.g. not rely on strings being null terminated).
+  //
+  // Parameters:
+  //  - visitor: A callable that receives a snapshot::SnapshotView.
+  template <typename Visitor>
+  bool Read(Visitor&& visitor) const {
+    const int kMaxAttempts{8};
+    for (int attempt = 0; attempt < kMaxAttempts; ++attempt) {
+      const std::uint64_t published{
+          header_->published.load(std::memory_order_acquire)};
+      if (published == 0) {
+        return false;
+      }
+      const snapshot::SlotHeader* slot{
+          SlotAt((published - 1) % header_->slot_count)};
+      const std::uint64_t sequence{
+          slot->sequence.load(std::memory_order_acquire)};
+      if (sequence % 2 != 0) {
+        continue;  // the publisher is writing this slot
+      }
+      visitor(snapshot::SnapshotView{slot});
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot->sequence.load(std::memory_order_relaxed) == sequence) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  const snapshot::SlotHeader* SlotAt(std::uint64_t index) const;
+  // Map the file in the path, replacing the current mapping. It throws like
+  // the constructor, and then the current mapping is kept.
+  void Map();
+
+  std::string path_{};
+  std::size_t size_{};
+  const snapshot::Header* header_{};
+  // The file that is mapped, to detect when it is replaced.
+  dev_t device_{};
+  ino_t inode_{};
+  bool stale_{false};
+  std::uint64_t last_published_{};
+  std::chrono::steady_clock::time_point last_publication_{};
+};
+
+#endif
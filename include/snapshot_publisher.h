@@ -0,0 +1,43 @@
+#ifndef SNAPSHOT_PUBLISHER_H
+#define SNAPSHOT_PUBLISHER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "snapshot.h"
+#include "system.h"
+
+// Publishes the metrics of a System in the shared memory once per tick.
+class SnapshotPublisher {
+ public:
+  // Constructor. It creates (or replaces) the shared-memory file.
+  //
+  // Parameters:
+  //  - path: The path of the shared-memory file.
+  //  - process_capacity: The maximum number of processes in each snapshot.
+  explicit SnapshotPublisher(const std::string& path = snapshot::kDefaultPath,
+                             std::uint32_t process_capacity = 65536);
+  SnapshotPublisher(const SnapshotPublisher&) = delete;
+  SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+  ~SnapshotPublisher();
+
+  // Sample the system and publish the result in the next slot of the ring.
+  //
+  // Parameters:
+  //  - system: The system we are collecting metrics from.
+  void Publish(System& system);
+  // Get a view of the last published snapshot. It must only be called after
+  // the first Publish, and it is consistent until the next Publish call.
+  snapshot::SnapshotView Latest() const;
+
+ private:
+  snapshot::SlotHeader* SlotAt(std::uint64_t index) const;
+
+  std::string path_{};
+  std::size_t size_{};
+  snapshot::Header* header_{};
+  std::uint64_t tick_{};
+};
+
+#endif
@@ -3,12 +3,24 @@
 
 #include <chrono>
 #include <ctime>
+#include <memory_resource>
 #include <string>
 #include <unordered_set>
 #include <vector>
 
+#include "batch_reader.h"
+#include "budget_governor.h"
+#include "cgroup.h"
+#include "disk.h"
+#include "exit_accounting.h"
+#include "interrupts.h"
+#include "metric_scheduler.h"
+#include "network.h"
+#include "numa.h"
+#include "pressure.h"
 #include "process.h"
 #include "processor.h"
+#include "tick_arena.h"
 #include "uid_resolver.h"
 
 // Represent an entire Linux based computer system. You can use it to get some
@@ -19,29 +31,133 @@ class System {
   explicit System();
   // Get the system's CPU instance.
   Processor& Cpu();
-  // Get the list of running processes.
+  // Get the system's Pressure Stall Information monitor, that also controls
+  // the refresh rate.
+  PressureMonitor& Pressure();
+  // Get the governor that keeps the CPU used by the monitor under its budget.
+  BudgetGovernor& Governor();
+  // Get the list of running processes, sorted by user and PID. The views sort
+  // them by other criteria with their columns (see
+  // process_columns::ColumnSet::Sort).
   std::vector<Process>& Processes();
+  // Get the number of running processes that were discovered in the last call
+  // to Processes() but were not added to the list yet. New processes are added
+  // under a time budget, so after the program start the list is filled in a
+  // few calls.
+  int PendingProcesses() const;
+  // Calculate the CPU utilization of all the processes in the current tick,
+  // reading their stat files in batches. It is meant for consumers that need
+  // every process (e.g. the snapshot publisher), while the UI reads only the
+  // visible ones.
+  void SampleProcessesCpu();
+  // Refresh the expensive metrics of the processes (see
+  // ExpensiveMetricScheduler) in the current tick, starting with a range of
+  // the list returned by the last Processes() call.
+  //
+  // Parameters:
+  //  - priority_first: The index of the first process refreshed first, e.g.
+  //  the first visible one.
+  //  - priority_count: The number of processes refreshed first.
+  void RefreshExpensiveMetrics(std::size_t priority_first,
+                               std::size_t priority_count);
+  // Get the scheduler of the expensive metrics.
+  const ExpensiveMetricScheduler& MetricScheduler() const;
+  // Read the process files in batches with io_uring. It returns false, and
+  // keeps reading them synchronously, if io_uring is not available.
+  bool EnableIoUring();
+  // Get the list of control groups of the unified cgroup hierarchy with their
+  // resource usage updated. The list is in hierarchical order: every group
+  // comes before its children, and siblings are sorted by the given key. It is
+  // empty if the system doesn't use cgroup v2.
+  //
+  // Parameters:
+  //  - sort_key: The criteria used to sort the groups with the same parent.
+  std::vector<Cgroup>& Cgroups(CgroupSortKey sort_key = CgroupSortKey::kCpu);
   // Get the memory utilization in megabytes (it considers the cached and
   // buffered usage also).
   float MemoryUtilization() const;
   // Get the system uptime in seconds.
   long UpTime() const;
+  // Get the memory statistics of each NUMA node in the current tick. It is
+  // empty in machines without NUMA support.
+  const std::vector<NumaNodeStats>& NumaNodes();
+  // Get the network statistics of the current tick.
+  const NetworkMonitor& Network();
+  // Get the block device statistics of the current tick. The rates are
+  // measured since the previous call, so it must be called every tick.
+  DiskMonitor& Disks();
+  // Get the interrupts handled by each CPU in the current tick. Like the
+  // disks, it must be called every tick.
+  InterruptMonitor& Interrupts();
+  // Set the share of an interrupt source above which a CPU is considered
+  // overloaded by it (see InterruptMonitor::SetImbalanceThreshold). Unlike
+  // Interrupts(), it doesn't sample the interrupts, so it can be called before
+  // the first tick.
+  //
+  // Parameters:
+  //  - threshold: The share, in the interval [0, 1.0].
+  void SetIrqImbalanceThreshold(float threshold);
+  // Get the accounting of the processes that exited recently, including the
+  // ones that were never seen by Processes(), updated in the current tick. It
+  // is empty until it is enabled (see ExitAccounting::Enable).
+  ExitAccounting& ExitedTasks();
+  // Start accounting the processes that exit (see ExitAccounting::Enable).
+  // Unlike ExitedTasks(), it doesn't read the records, so they are attributed
+  // to the tick that reads them.
+  bool EnableExitAccounting();
   // Get the total number of processes in the system.
   int TotalProcesses() const;
   // Get the number of current running processes.
   int RunningProcesses() const;
   // Get the current kernel description.
-  std::string Kernel() const;
+  const std::string& Kernel() const;
   // Get the current Linux system version description.
-  std::string OperatingSystem() const;
+  const std::string& OperatingSystem() const;
+  // Get the memory resource for the temporary allocations of the current tick.
+  // Everything allocated from it is released by EndTick().
+  std::pmr::memory_resource* TickResource();
+  // Get the sampling context of the current tick. The first call in a tick
+  // takes the timestamp and reads the CPU times, and the next calls return the
+  // same values until EndTick() is called, so that all the rates calculated in
+  // a tick use the same interval.
+  const TickSample& Sample();
+  // Get the time point of the current tick (see Sample()).
+  std::chrono::steady_clock::time_point TickTime();
+  // Get the CPU utilization of the system in the current tick (see
+  // Processor::Utilization).
+  float CpuUtilization();
+  // Finish the current tick, releasing all the memory allocated from the tick
+  // resource.
+  void EndTick();
 
  private:
   Processor cpu_{};
+  PressureMonitor pressure_{};
+  NumaMonitor numa_{};
+  NetworkMonitor network_{};
+  DiskMonitor disks_{};
+  InterruptMonitor interrupts_{};
+  ExitAccounting exited_tasks_{};
+  BudgetGovernor governor_{};
   std::vector<Process> processes_{};
+  int pending_processes_{};
+  std::vector<Cgroup> cgroups_{};
+  // Reused to reorder the cgroups without allocating memory in every update.
+  std::vector<Cgroup> cgroups_buffer_{};
   std::chrono::system_clock::time_point boot_time_{};
   std::string kernel_version_{};
   std::string os_name_{};
+  // Mount point of the cgroup v2 hierarchy, empty if it is not available.
+  std::string cgroup_root_{};
   UidResolver uid_resolver_{};
+  BatchReader batch_reader_{};
+  ExpensiveMetricScheduler metric_scheduler_{};
+  // Arena for the temporary allocations made while sampling and rendering a
+  // tick. It is mutable since the const getters also read files.
+  mutable TickArena tick_arena_{};
+  // The sampling context of the current tick. Its time is the epoch if it was
+  // not taken yet.
+  TickSample tick_sample_{};
 };
 
 #endif
@@ -0,0 +1,66 @@
+#ifndef TICK_ARENA_H
+#define TICK_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+// Memory arena used for the short-lived allocations made during one refresh
+// cycle (a "tick") of the monitor.
+//
+// Every temporary object created while sampling "/proc" and rendering the UI
+// (file contents, paths, lookup tables, formatted strings) is allocated from
+// the arena resource, and everything is discarded at once when the tick ends.
+// The arena owns a preallocated buffer. When a tick needs more memory than the
+// buffer holds, the extra memory comes from the global heap and the buffer is
+// enlarged in the next reset, so after a few ticks (warm-up) the sampling
+// loop stops touching the global heap.
+class TickArena {
+ public:
+  // Constructor.
+  //
+  // Parameters:
+  //  - initial_capacity: The initial size of the arena buffer in bytes.
+  explicit TickArena(std::size_t initial_capacity = 256 * 1024);
+  TickArena(const TickArena&) = delete;
+  TickArena& operator=(const TickArena&) = delete;
+
+  // Get the memory resource that should be used for the tick allocations.
+  std::pmr::memory_resource* Resource();
+  // Release all the memory allocated since the last reset. It must be called
+  // at the end of each tick, when no object allocated from the arena is alive
+  // anymore.
+  void Reset();
+  // Get the current size of the arena buffer in bytes.
+  std::size_t Capacity() const;
+  // Get the number of allocations in the current tick that did not fit in the
+  // arena buffer and were forwarded to the global heap.
+  std::size_t OverflowAllocations() const;
+
+ private:
+  // Upstream resource of the arena. It forwards the requests to the global heap
+  // and counts how much memory was requested, so that we can grow the arena
+  // buffer to the size really used by a tick.
+  class OverflowResource : public std::pmr::memory_resource {
+   public:
+    std::size_t allocations{};
+    std::size_t bytes{};
+
+   private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* p, std::size_t bytes,
+                       std::size_t alignment) override;
+    bool do_is_equal(
+        const std::pmr::memory_resource& other) const noexcept override;
+  };
+
+  std::size_t capacity_{};
+  std::unique_ptr<std::byte[]> buffer_{};
+  OverflowResource overflow_{};
+  // The monotonic resource can't be rebound to a new buffer, so it is
+  // recreated whenever the arena grows.
+  std::optional<std::pmr::monotonic_buffer_resource> resource_{};
+};
+
+#endif
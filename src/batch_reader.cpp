@@ -0,0 +1,415 @@
+#include "batch_reader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "parser_helper.h"
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define HAS_IO_URING 1
+#endif
+
+#ifdef HAS_IO_URING
+
+namespace {
+
+// Size of the buffer slot of each file. It fits the "/proc/<pid>" files we
+// read once per tick. A file that fills its slot may be larger, so it is read
+// again with the synchronous reader.
+const std::size_t kSlotSize{4096};
+
+// The operations of each file, encoded in the user data of the requests. The
+// cancel request is not related to a file.
+enum Operation : std::uint64_t {
+  kOpen = 0,
+  kRead = 1,
+  kClose = 2,
+  kCancel = 3
+};
+
+int IoUringSetup(unsigned entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IoUringEnter(int ring_fd, unsigned to_submit, unsigned min_complete) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit,
+                                  min_complete, IORING_ENTER_GETEVENTS,
+                                  nullptr, 0));
+}
+
+int IoUringRegister(int ring_fd, unsigned opcode, const void* arg,
+                    unsigned count) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_register, ring_fd, opcode, arg, count));
+}
+
+// The ring indexes are shared with the kernel, so they are accessed with
+// atomic operations, like liburing does.
+std::uint32_t LoadAcquire(const std::uint32_t* index) {
+  return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+}
+
+void StoreRelease(std::uint32_t* index, std::uint32_t value) {
+  __atomic_store_n(index, value, __ATOMIC_RELEASE);
+}
+
+// Get a pointer to a field of a memory mapped ring, given its offset.
+template <typename T>
+T* RingField(void* ring, std::uint32_t offset) {
+  return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+
+}  // namespace
+
+struct BatchReader::Ring {
+  ~Ring() {
+    // Closing the ring waits for the requests in flight, so it is done before
+    // releasing the memory they may write to.
+    if (fd >= 0) {
+      close(fd);
+    }
+    if (completion_ring != nullptr && completion_ring != submission_ring) {
+      munmap(completion_ring, completion_ring_size);
+    }
+    if (submission_ring != nullptr) {
+      munmap(submission_ring, submission_ring_size);
+    }
+    if (entries != nullptr) {
+      munmap(entries, entries_size);
+    }
+  }
+
+  // Cancel the requests in flight and wait for their completions, which are
+  // discarded. The requests that were queued but not submitted are dropped.
+  // It returns false if the completions could not be waited for, in which case
+  // the kernel may still write to the buffer.
+  //
+  // Parameters:
+  //  - in_flight: The number of submitted requests without a completion.
+  bool CancelInFlight(std::size_t in_flight) {
+    auto* submission_head{
+        RingField<std::uint32_t>(submission_ring, params.sq_off.head)};
+    auto* submission_tail{
+        RingField<std::uint32_t>(submission_ring, params.sq_off.tail)};
+    const std::uint32_t submission_mask{
+        *RingField<std::uint32_t>(submission_ring, params.sq_off.ring_mask)};
+    auto* submission_array{
+        RingField<std::uint32_t>(submission_ring, params.sq_off.array)};
+    std::uint32_t tail{LoadAcquire(submission_head)};
+    // A single request cancels all the others (Linux 5.19). In older kernels
+    // it fails, and we just wait for the requests to finish, which they do
+    // since they only read small files.
+    unsigned to_submit{0};
+    bool cancel_pending{false};
+    if (in_flight > 0) {
+      io_uring_sqe cancel_request{};
+      cancel_request.opcode = IORING_OP_ASYNC_CANCEL;
+      cancel_request.cancel_flags = IORING_ASYNC_CANCEL_ANY;
+      cancel_request.user_data = kCancel;
+      const std::uint32_t index{tail & submission_mask};
+      entries[index] = cancel_request;
+      submission_array[index] = index;
+      ++tail;
+      to_submit = 1;
+      cancel_pending = true;
+    }
+    StoreRelease(submission_tail, tail);
+
+    auto* completion_head{
+        RingField<std::uint32_t>(completion_ring, params.cq_off.head)};
+    auto* completion_tail{
+        RingField<std::uint32_t>(completion_ring, params.cq_off.tail)};
+    const std::uint32_t completion_mask{
+        *RingField<std::uint32_t>(completion_ring, params.cq_off.ring_mask)};
+    auto* completions{
+        RingField<io_uring_cqe>(completion_ring, params.cq_off.cqes)};
+    while (in_flight > 0 || cancel_pending) {
+      const int submitted{IoUringEnter(fd, to_submit, 1)};
+      if (submitted < 0) {
+        // The ring is busy while the completion queue is full, so we go on
+        // reaping completions.
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+          return false;
+        }
+      } else {
+        to_submit -= std::min(to_submit, static_cast<unsigned>(submitted));
+      }
+      std::uint32_t head{*completion_head};
+      const std::uint32_t available_tail{LoadAcquire(completion_tail)};
+      for (; head != available_tail; ++head) {
+        if (completions[head & completion_mask].user_data == kCancel) {
+          cancel_pending = false;
+        } else if (in_flight > 0) {
+          --in_flight;
+        }
+      }
+      StoreRelease(completion_head, head);
+    }
+    return true;
+  }
+
+  int fd{-1};
+  io_uring_params params{};
+  void* submission_ring{};
+  std::size_t submission_ring_size{};
+  void* completion_ring{};
+  std::size_t completion_ring_size{};
+  io_uring_sqe* entries{};
+  std::size_t entries_size{};
+  // The buffer registered in the kernel, with one slot per file of a batch.
+  std::vector<char> buffer{};
+};
+
+bool BatchReader::EnableIoUring() {
+  if (ring_) {
+    return true;
+  }
+  auto ring{std::make_unique<Ring>()};
+  // Each file needs three requests: open, read and close.
+  ring->fd = IoUringSetup(static_cast<unsigned>(3 * batch_size_),
+                          &ring->params);
+  if (ring->fd < 0) {
+    // The kernel is older than 5.1, or io_uring is disabled (e.g. by the
+    // kernel.io_uring_disabled sysctl or a seccomp filter).
+    return false;
+  }
+  const io_uring_params& params{ring->params};
+  if (params.sq_entries < 3 * batch_size_ ||
+      params.cq_entries < 3 * batch_size_) {
+    return false;
+  }
+
+  ring->submission_ring_size =
+      params.sq_off.array + params.sq_entries * sizeof(std::uint32_t);
+  ring->completion_ring_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->submission_ring_size = ring->completion_ring_size =
+        std::max(ring->submission_ring_size, ring->completion_ring_size);
+  }
+  void* submission_ring{mmap(nullptr, ring->submission_ring_size,
+                             PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring->fd, IORING_OFF_SQ_RING)};
+  if (submission_ring == MAP_FAILED) {
+    return false;
+  }
+  ring->submission_ring = submission_ring;
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->completion_ring = submission_ring;
+  } else {
+    void* completion_ring{mmap(nullptr, ring->completion_ring_size,
+                               PROT_READ | PROT_WRITE,
+                               MAP_SHARED | MAP_POPULATE, ring->fd,
+                               IORING_OFF_CQ_RING)};
+    if (completion_ring == MAP_FAILED) {
+      return false;
+    }
+    ring->completion_ring = completion_ring;
+  }
+  ring->entries_size = params.sq_entries * sizeof(io_uring_sqe);
+  void* entries{mmap(nullptr, ring->entries_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES)};
+  if (entries == MAP_FAILED) {
+    return false;
+  }
+  ring->entries = static_cast<io_uring_sqe*>(entries);
+
+  // The buffer is registered once, so the kernel doesn't need to map the
+  // destination pages of every read.
+  ring->buffer.resize(batch_size_ * kSlotSize);
+  const iovec buffer_vector{ring->buffer.data(), ring->buffer.size()};
+  if (IoUringRegister(ring->fd, IORING_REGISTER_BUFFERS, &buffer_vector, 1) <
+      0) {
+    return false;
+  }
+  // An empty table of direct descriptors, one per file of a batch. The open
+  // requests install the files in the table, so the linked read and close
+  // requests can refer to them without knowing a file descriptor.
+  const std::vector<int> files(batch_size_, -1);
+  if (IoUringRegister(ring->fd, IORING_REGISTER_FILES, files.data(),
+                      static_cast<unsigned>(files.size())) < 0) {
+    return false;
+  }
+  ring_ = std::move(ring);
+
+  // Direct descriptors need Linux 5.15, which can't be detected by the
+  // features, so we try to read a file we know.
+  std::pmr::vector<std::pmr::string> paths{1};
+  paths[0] = "/proc/self/stat";
+  std::pmr::vector<std::pmr::string> contents{};
+  if (!ReadBatch(paths, 0, 1, contents) || contents[0].empty()) {
+    ring_.reset();
+    return false;
+  }
+  return true;
+}
+
+bool BatchReader::ReadBatch(const std::pmr::vector<std::pmr::string>& paths,
+                            const std::size_t first, const std::size_t count,
+                            std::pmr::vector<std::pmr::string>& contents) {
+  if (contents.size() < first + count) {
+    contents.resize(first + count);
+  }
+  const io_uring_params& params{ring_->params};
+  void* submission_ring{ring_->submission_ring};
+  void* completion_ring{ring_->completion_ring};
+  auto* submission_tail{
+      RingField<std::uint32_t>(submission_ring, params.sq_off.tail)};
+  const std::uint32_t submission_mask{
+      *RingField<std::uint32_t>(submission_ring, params.sq_off.ring_mask)};
+  auto* submission_array{
+      RingField<std::uint32_t>(submission_ring, params.sq_off.array)};
+
+  // Queue the open, read and close requests of each file, linked so that they
+  // are executed in order.
+  std::uint32_t tail{*submission_tail};
+  const auto queue = [&](const io_uring_sqe& request) {
+    const std::uint32_t index{tail & submission_mask};
+    ring_->entries[index] = request;
+    submission_array[index] = index;
+    ++tail;
+  };
+  for (std::size_t i = 0; i < count; ++i) {
+    const std::uint64_t user_data{i * 4};
+    io_uring_sqe open_request{};
+    open_request.opcode = IORING_OP_OPENAT;
+    open_request.flags = IOSQE_IO_LINK;
+    open_request.fd = AT_FDCWD;
+    open_request.addr =
+        reinterpret_cast<std::uint64_t>(paths[first + i].c_str());
+    // O_CLOEXEC is not allowed (nor needed) for direct descriptors.
+    open_request.open_flags = O_RDONLY;
+    // The index is one based, zero means a regular file descriptor.
+    open_request.file_index = static_cast<std::uint32_t>(i + 1);
+    open_request.user_data = user_data + kOpen;
+    queue(open_request);
+
+    io_uring_sqe read_request{};
+    read_request.opcode = IORING_OP_READ_FIXED;
+    // The close must be executed even if the read fails.
+    read_request.flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+    read_request.fd = static_cast<std::int32_t>(i);
+    read_request.addr =
+        reinterpret_cast<std::uint64_t>(ring_->buffer.data() + i * kSlotSize);
+    read_request.len = kSlotSize;
+    read_request.buf_index = 0;
+    read_request.user_data = user_data + kRead;
+    queue(read_request);
+
+    io_uring_sqe close_request{};
+    close_request.opcode = IORING_OP_CLOSE;
+    close_request.file_index = static_cast<std::uint32_t>(i + 1);
+    close_request.user_data = user_data + kClose;
+    queue(close_request);
+  }
+  StoreRelease(submission_tail, tail);
+
+  // Submit everything and wait for all the completions.
+  auto* completion_head{
+      RingField<std::uint32_t>(completion_ring, params.cq_off.head)};
+  auto* completion_tail{
+      RingField<std::uint32_t>(completion_ring, params.cq_off.tail)};
+  const std::uint32_t completion_mask{
+      *RingField<std::uint32_t>(completion_ring, params.cq_off.ring_mask)};
+  auto* completions{
+      RingField<io_uring_cqe>(completion_ring, params.cq_off.cqes)};
+  unsigned to_submit{static_cast<unsigned>(3 * count)};
+  std::size_t pending{3 * count};
+  while (pending > 0) {
+    const int submitted{IoUringEnter(ring_->fd, to_submit,
+                                     static_cast<unsigned>(pending))};
+    if (submitted < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // The requests in flight write to the registered buffer, so they must
+      // finish before the ring is destroyed. If they can't be waited for, the
+      // ring and its buffer are leaked instead.
+      if (!ring_->CancelInFlight(pending - to_submit)) {
+        static_cast<void>(ring_.release());
+      }
+      return false;
+    }
+    to_submit -= std::min(to_submit, static_cast<unsigned>(submitted));
+    std::uint32_t head{*completion_head};
+    const std::uint32_t available_tail{LoadAcquire(completion_tail)};
+    for (; head != available_tail; ++head, --pending) {
+      const io_uring_cqe& completion{completions[head & completion_mask]};
+      if (completion.user_data % 4 != kRead) {
+        continue;
+      }
+      const std::size_t i{completion.user_data / 4};
+      std::pmr::string& content{contents[first + i]};
+      if (completion.res < 0) {
+        content.clear();
+      } else if (static_cast<std::size_t>(completion.res) < kSlotSize) {
+        content.assign(ring_->buffer.data() + i * kSlotSize,
+                       static_cast<std::size_t>(completion.res));
+      } else if (!parser_helper::TryReadFile(paths[first + i].c_str(),
+                                             content)) {
+        // The file may be larger than the slot.
+        content.clear();
+      }
+    }
+    StoreRelease(completion_head, head);
+  }
+  return true;
+}
+
+#else
+
+struct BatchReader::Ring {};
+
+bool BatchReader::EnableIoUring() { return false; }
+
+bool BatchReader::ReadBatch(const std::pmr::vector<std::pmr::string>&,
+                            std::size_t, std::size_t,
+                            std::pmr::vector<std::pmr::string>&) {
+  return false;
+}
+
+#endif
+
+BatchReader::BatchReader(const std::size_t batch_size)
+    : batch_size_{batch_size} {}
+
+BatchReader::~BatchReader() = default;
+
+BatchReader::Backend BatchReader::ActiveBackend() const {
+  return ring_ ? Backend::kIoUring : Backend::kSync;
+}
+
+void BatchReader::Read(const std::pmr::vector<std::pmr::string>& paths,
+                       std::pmr::vector<std::pmr::string>& contents) {
+  contents.resize(paths.size());
+  std::size_t first{0};
+  if (ring_) {
+    for (; first < paths.size(); first += batch_size_) {
+      const std::size_t count{std::min(batch_size_, paths.size() - first)};
+      if (!ReadBatch(paths, first, count, contents)) {
+        // The ring can't be trusted anymore, so we stop using it.
+        ring_.reset();
+        break;
+      }
+    }
+  }
+  for (; first < paths.size(); ++first) {
+    if (!parser_helper::TryReadFile(paths[first].c_str(), contents[first])) {
+      contents[first].clear();
+    }
+  }
+}
@@ -0,0 +1,102 @@
+#include "budget_governor.h"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+#include "parser_helper.h"
+
+namespace {
+
+// Number of consecutive updates needed to change the level. The level is
+// raised quickly, but only lowered after the usage stays low for a while, so
+// it doesn't oscillate.
+const int kTicksToRaise{2};
+const int kTicksToLower{5};
+// The level is lowered only when the usage is under this fraction of the
+// budget, since the full detail costs more than the degraded one.
+const float kLowerThreshold{0.5f};
+// Weight of the last measurement in the smoothed usage.
+const float kSmoothing{0.5f};
+
+}  // namespace
+
+BudgetGovernor::BudgetGovernor(const float budget) : budget_{budget} {}
+
+void BudgetGovernor::SetBudget(const float budget) { budget_ = budget; }
+
+float BudgetGovernor::Budget() const { return budget_; }
+
+void BudgetGovernor::Update(const std::chrono::steady_clock::time_point now,
+                            std::pmr::memory_resource* resource) {
+  if (now == last_update_) {
+    return;
+  }
+  std::pmr::string content{resource};
+  if (!parser_helper::TryReadFile("/proc/self/stat", content)) {
+    return;
+  }
+  // The command name (2nd property) is enclosed in parenthesis and can contain
+  // spaces, so the fields are counted from the last ')'. The user and kernel
+  // times are the 14th and 15th properties, in clock ticks.
+  const std::size_t command_end{content.rfind(')')};
+  if (command_end == std::string::npos) {
+    return;
+  }
+  parser_helper::FieldTokenizer tokenizer{
+      std::string_view{content}.substr(command_end + 1)};
+  tokenizer.Skip(11);
+  const long long utime{tokenizer.NextNumber<long long>()};
+  const long long stime{tokenizer.NextNumber<long long>()};
+  const long long cpu_ticks{utime + stime};
+
+  const bool first_update{last_update_ ==
+                          std::chrono::steady_clock::time_point{}};
+  const double elapsed_seconds{
+      std::chrono::duration<double>(now - last_update_).count()};
+  const long long cpu_ticks_delta{cpu_ticks - last_cpu_ticks_};
+  last_update_ = now;
+  last_cpu_ticks_ = cpu_ticks;
+  if (first_update || elapsed_seconds <= 0) {
+    return;
+  }
+
+  const float usage{static_cast<float>(
+      cpu_ticks_delta / static_cast<double>(sysconf(_SC_CLK_TCK)) /
+      elapsed_seconds)};
+  usage_ = kSmoothing * usage + (1 - kSmoothing) * usage_;
+
+  ticks_over_budget_ = usage_ > budget_ ? ticks_over_budget_ + 1 : 0;
+  ticks_under_budget_ =
+      usage_ < budget_ * kLowerThreshold ? ticks_under_budget_ + 1 : 0;
+  if (ticks_over_budget_ >= kTicksToRaise &&
+      level_ != DegradationLevel::kSlowRefresh) {
+    level_ = static_cast<DegradationLevel>(static_cast<int>(level_) + 1);
+    ticks_over_budget_ = 0;
+  } else if (ticks_under_budget_ >= kTicksToLower &&
+             level_ != DegradationLevel::kNone) {
+    level_ = static_cast<DegradationLevel>(static_cast<int>(level_) - 1);
+    ticks_under_budget_ = 0;
+  }
+}
+
+float BudgetGovernor::Usage() const { return usage_; }
+
+DegradationLevel BudgetGovernor::Level() const { return level_; }
+
+const char* BudgetGovernor::Describe(const DegradationLevel level) {
+  switch (level) {
+    case DegradationLevel::kNone:
+      return "full detail";
+    case DegradationLevel::kNoExpensiveColumns:
+      return "no expensive columns";
+    case DegradationLevel::kFewerDetailedRows:
+      return "fewer detailed rows";
+    case DegradationLevel::kSlowRefresh:
+      return "slow refresh";
+  }
+  return "";
+}
@@ -0,0 +1,192 @@
+#include "cgroup.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "format.h"
+#include "parser_helper.h"
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+namespace {
+
+// Read a cgroup interface file that contains a single number, like
+// "memory.current". It returns 0 if the file doesn't exist, which is the case
+// of some files in the root cgroup or when a controller is not enabled.
+long ReadSingleValue(std::string_view directory, std::string_view file_name,
+                     std::pmr::memory_resource* resource) {
+  std::pmr::string path{resource};
+  fmt::format_to(std::back_inserter(path), "{}/{}", directory, file_name);
+  std::pmr::string content{resource};
+  if (!parser_helper::TryReadFile(path.c_str(), content)) {
+    return 0;
+  }
+  return parser_helper::FieldTokenizer{content}.NextNumber<long>();
+}
+
+// Read a flat keyed cgroup interface file, like "cpu.stat" or "memory.stat",
+// into its content. It returns an empty string if the file doesn't exist.
+std::pmr::string ReadKeyedFile(std::string_view directory,
+                               std::string_view file_name,
+                               std::pmr::memory_resource* resource) {
+  std::pmr::string path{resource};
+  fmt::format_to(std::back_inserter(path), "{}/{}", directory, file_name);
+  std::pmr::string content{resource};
+  parser_helper::TryReadFile(path.c_str(), content);
+  return content;
+}
+
+long KeyedValue(std::string_view content, std::string_view key) {
+  return parser_helper::FieldTokenizer{parser_helper::FindValue(content, key)}
+      .NextNumber<long>();
+}
+
+// Sum the bytes read and written in all devices listed in the "io.stat" file.
+//
+// Each line of the file has the format:
+//   <major>:<minor> rbytes=<n> wbytes=<n> rios=<n> wios=<n> dbytes=<n> dios=<n>
+std::pair<long, long> SumIoBytes(std::string_view content) {
+  long read_bytes{0};
+  long write_bytes{0};
+  parser_helper::FieldTokenizer tokenizer{content};
+  for (std::string_view field{tokenizer.Next()}; !field.empty();
+       field = tokenizer.Next()) {
+    const std::size_t separator_pos{field.find('=')};
+    if (separator_pos == std::string_view::npos) {
+      continue;  // it is the device id
+    }
+    const std::string_view key{field.substr(0, separator_pos)};
+    const long value{
+        parser_helper::FieldTokenizer{field.substr(separator_pos + 1)}
+            .NextNumber<long>()};
+    if (key == "rbytes") {
+      read_bytes += value;
+    } else if (key == "wbytes") {
+      write_bytes += value;
+    }
+  }
+  return {read_bytes, write_bytes};
+}
+
+}  // namespace
+
+Cgroup::Cgroup(std::string path, const int depth)
+    : path_{std::move(path)}, depth_{depth} {}
+
+const std::string& Cgroup::Path() const { return path_; }
+
+std::string_view Cgroup::Name() const {
+  if (path_ == "/") {
+    return path_;
+  }
+  return std::string_view{path_}.substr(path_.rfind('/') + 1);
+}
+
+std::string_view Cgroup::ParentPath() const {
+  if (path_ == "/") {
+    return {};
+  }
+  const std::size_t separator_pos{path_.rfind('/')};
+  // The children of the root have a path like "/<name>".
+  return std::string_view{path_}.substr(0, std::max<std::size_t>(
+                                                separator_pos, 1));
+}
+
+int Cgroup::Depth() const { return depth_; }
+
+float Cgroup::CpuUtilization() const { return cpu_utilization_; }
+
+long Cgroup::MemoryBytes() const { return memory_bytes_; }
+
+long Cgroup::AnonymousMemoryBytes() const { return anon_memory_bytes_; }
+
+long Cgroup::FileMemoryBytes() const { return file_memory_bytes_; }
+
+float Cgroup::ReadBytesPerSecond() const { return read_bytes_per_second_; }
+
+float Cgroup::WriteBytesPerSecond() const { return write_bytes_per_second_; }
+
+long Cgroup::Pids() const { return pids_; }
+
+float Cgroup::Pressure(const PressureResource pressure_resource) const {
+  return pressure_[static_cast<std::size_t>(pressure_resource)];
+}
+
+bool Cgroup::Less(const Cgroup& a, const Cgroup& b, const CgroupSortKey key) {
+  switch (key) {
+    case CgroupSortKey::kCpu:
+      return a.cpu_utilization_ > b.cpu_utilization_;
+    case CgroupSortKey::kMemory:
+      return a.memory_bytes_ > b.memory_bytes_;
+    case CgroupSortKey::kIo:
+      return a.read_bytes_per_second_ + a.write_bytes_per_second_ >
+             b.read_bytes_per_second_ + b.write_bytes_per_second_;
+    case CgroupSortKey::kPids:
+      return a.pids_ > b.pids_;
+    case CgroupSortKey::kName:
+      return a.Name() < b.Name();
+  }
+  return false;
+}
+
+void Cgroup::Update(std::string_view root, const steady_clock::time_point now,
+                    std::pmr::memory_resource* resource) {
+  // The files of a cgroup are in the directory "<root><path>". Every value is
+  // hierarchical, i.e., it includes the usage of the descendant groups.
+  std::pmr::string directory{resource};
+  fmt::format_to(std::back_inserter(directory), "{}{}", root,
+                 path_ == "/" ? std::string_view{} : std::string_view{path_});
+
+  // "cpu.stat" has the CPU time consumed by the group in microseconds.
+  const long usage_usec{
+      KeyedValue(ReadKeyedFile(directory, "cpu.stat", resource), "usage_usec")};
+  const std::pmr::string memory_stat{
+      ReadKeyedFile(directory, "memory.stat", resource)};
+  anon_memory_bytes_ = KeyedValue(memory_stat, "anon ");
+  file_memory_bytes_ = KeyedValue(memory_stat, "file ");
+  memory_bytes_ = ReadSingleValue(directory, "memory.current", resource);
+  if (memory_bytes_ == 0) {
+    // The root cgroup has no "memory.current" file.
+    memory_bytes_ = anon_memory_bytes_ + file_memory_bytes_;
+  }
+  pids_ = ReadSingleValue(directory, "pids.current", resource);
+  const auto [read_bytes, write_bytes] =
+      SumIoBytes(ReadKeyedFile(directory, "io.stat", resource));
+  // The root cgroup has no pressure files, so the system wide files are used.
+  const char* kPressureFiles[]{"cpu.pressure", "memory.pressure",
+                               "io.pressure"};
+  const char* kSystemPressureFiles[]{"cpu", "memory", "io"};
+  for (std::size_t i = 0; i < pressure_.size(); ++i) {
+    const std::pmr::string content{
+        path_ == "/"
+            ? ReadKeyedFile("/proc/pressure", kSystemPressureFiles[i], resource)
+            : ReadKeyedFile(directory, kPressureFiles[i], resource)};
+    pressure_[i] = ParsePressure(content).some_avg10;
+  }
+
+  if (has_previous_sample_) {
+    const double elapsed_seconds{
+        duration<double>(now - last_update_).count()};
+    if (elapsed_seconds > 0) {
+      // The usage is relative to all the online CPUs, like the processes.
+      const long cpus{std::max(sysconf(_SC_NPROCESSORS_ONLN), 1L)};
+      cpu_utilization_ =
+          (usage_usec - usage_usec_) / (elapsed_seconds * 1'000'000 * cpus);
+      read_bytes_per_second_ = (read_bytes - read_bytes_) / elapsed_seconds;
+      write_bytes_per_second_ = (write_bytes - write_bytes_) / elapsed_seconds;
+    }
+  }
+  has_previous_sample_ = true;
+  last_update_ = now;
+  usage_usec_ = usage_usec;
+  read_bytes_ = read_bytes;
+  write_bytes_ = write_bytes;
+}
@@ -0,0 +1,183 @@
+#include "disk.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parser_helper.h"
+
+namespace {
+
+// The sector size used by the kernel in the statistics, no matter the real
+// sector size of the device.
+const double kSectorSize{512};
+
+// Check if a path exists.
+bool PathExists(const std::string& path) {
+  struct stat status {};
+  return stat(path.c_str(), &status) == 0;
+}
+
+// Calculate the rate of a counter in the interval.
+float Rate(std::uint64_t current, std::uint64_t previous, double seconds) {
+  if (seconds <= 0 || current < previous) {
+    return 0;
+  }
+  return static_cast<float>((current - previous) / seconds);
+}
+
+// Calculate the average time per request of the requests completed in the
+// interval.
+float Latency(std::uint64_t time_ms, std::uint64_t previous_time_ms,
+              std::uint64_t requests, std::uint64_t previous_requests) {
+  if (requests <= previous_requests || time_ms < previous_time_ms) {
+    return 0;
+  }
+  return static_cast<float>(time_ms - previous_time_ms) /
+         static_cast<float>(requests - previous_requests);
+}
+
+}  // namespace
+
+void DiskMonitor::Update(const std::chrono::steady_clock::time_point now,
+                         std::pmr::memory_resource* resource) {
+  if (now == last_update_) {
+    return;
+  }
+  // In the first update we consider the time since the boot.
+  const bool first_update{last_update_ ==
+                          std::chrono::steady_clock::time_point{}};
+  double elapsed_seconds{
+      std::chrono::duration<double>(now - last_update_).count()};
+  if (first_update) {
+    timespec boot_time{};
+    clock_gettime(CLOCK_BOOTTIME, &boot_time);
+    elapsed_seconds = boot_time.tv_sec + boot_time.tv_nsec / 1e9;
+  }
+  last_update_ = now;
+
+  std::pmr::string content{resource};
+  if (!parser_helper::TryReadFile("/proc/diskstats", content)) {
+    devices_.clear();
+    return;
+  }
+  // Each line has the format "<major> <minor> <name> <counters...>". The
+  // devices are identified by their numbers, and they are usually in the same
+  // order in every update, so matching them with the previous update is cheap
+  // even with hundreds of devices.
+  std::size_t count{0};
+  parser_helper::ForEachLine(content, [&](std::string_view line) {
+    parser_helper::FieldTokenizer tokenizer{line};
+    const unsigned major{tokenizer.NextNumber<unsigned>()};
+    const unsigned minor{tokenizer.NextNumber<unsigned>()};
+    const std::string_view name{tokenizer.Next()};
+    if (name.empty()) {
+      return;
+    }
+    const auto same_device = [major, minor](const DiskStats& device) {
+      return device.major == major && device.minor == minor;
+    };
+    auto found = count < devices_.size() && same_device(devices_[count])
+                     ? devices_.begin() + count
+                     : std::find_if(devices_.begin() + count, devices_.end(),
+                                    same_device);
+    const bool new_device{found == devices_.end()};
+    if (new_device) {
+      // The device kind is checked in sysfs only once, when the device is
+      // found.
+      DiskStats device{};
+      device.major = major;
+      device.minor = minor;
+      device.name = std::string{name};
+      device.partition =
+          PathExists("/sys/class/block/" + device.name + "/partition");
+      device.is_virtual =
+          PathExists("/sys/devices/virtual/block/" + device.name);
+      found = devices_.insert(devices_.begin() + count, std::move(device));
+    } else if (found != devices_.begin() + count) {
+      std::rotate(devices_.begin() + count, found, found + 1);
+      found = devices_.begin() + count;
+    }
+    ++count;
+
+    DiskStats& device{*found};
+    std::array<std::uint64_t, kDiskCounterCount> counters{};
+    for (std::uint64_t& counter : counters) {
+      counter = tokenizer.NextNumber<std::uint64_t>();
+    }
+    // The first counters of a device found after the first update (e.g. a
+    // hot-plugged disk) are only stored, since they were not accumulated in
+    // the interval.
+    if (new_device && !first_update) {
+      device.counters = counters;
+      return;
+    }
+    const auto& previous = device.counters;
+    device.reads_per_second = Rate(counters[kReadsCompleted],
+                                   previous[kReadsCompleted], elapsed_seconds);
+    device.writes_per_second =
+        Rate(counters[kWritesCompleted], previous[kWritesCompleted],
+             elapsed_seconds);
+    device.read_bytes_per_second =
+        Rate(counters[kSectorsRead], previous[kSectorsRead], elapsed_seconds) *
+        kSectorSize;
+    device.write_bytes_per_second =
+        Rate(counters[kSectorsWritten], previous[kSectorsWritten],
+             elapsed_seconds) *
+        kSectorSize;
+    device.read_latency_ms =
+        Latency(counters[kReadTimeMs], previous[kReadTimeMs],
+                counters[kReadsCompleted], previous[kReadsCompleted]);
+    device.write_latency_ms =
+        Latency(counters[kWriteTimeMs], previous[kWriteTimeMs],
+                counters[kWritesCompleted], previous[kWritesCompleted]);
+    device.utilization = std::min(
+        Rate(counters[kIoTimeMs], previous[kIoTimeMs], elapsed_seconds) /
+            1000,
+        1.0f);
+    device.counters = counters;
+  });
+  devices_.resize(count);
+}
+
+const std::vector<DiskStats>& DiskMonitor::Devices() const { return devices_; }
+
+const std::vector<const DiskStats*>& DiskMonitor::Busiest(
+    const DiskFilter filter, const std::size_t n) {
+  busiest_.clear();
+  for (const DiskStats& device : devices_) {
+    if (Accepts(filter, device)) {
+      busiest_.push_back(&device);
+    }
+  }
+  // Only the first n devices need to be sorted.
+  const auto middle = busiest_.begin() + std::min(n, busiest_.size());
+  std::partial_sort(busiest_.begin(), middle, busiest_.end(),
+                    [](const DiskStats* a, const DiskStats* b) {
+                      if (a->utilization != b->utilization) {
+                        return a->utilization > b->utilization;
+                      }
+                      return a->name < b->name;
+                    });
+  busiest_.erase(middle, busiest_.end());
+  return busiest_;
+}
+
+bool DiskMonitor::Accepts(const DiskFilter filter, const DiskStats& device) {
+  switch (filter) {
+    case DiskFilter::kPhysical:
+      return !device.partition && !device.is_virtual;
+    case DiskFilter::kPartitions:
+      return !device.is_virtual;
+    case DiskFilter::kAll:
+      return true;
+  }
+  return true;
+}
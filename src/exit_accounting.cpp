@@ -0,0 +1,325 @@
+#include "exit_accounting.h"
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if __has_include(<linux/taskstats.h>)
+#include <linux/genetlink.h>
+#include <linux/netlink.h>
+#include <linux/taskstats.h>
+#define HAS_TASKSTATS 1
+#endif
+
+namespace {
+
+// The commands are forgotten when they don't exit for this long.
+const std::chrono::seconds kRecentWindow{60};
+
+#ifdef HAS_TASKSTATS
+
+// Size of the socket receive buffer. The records are read once per tick, so
+// it must hold the exits of a busy build in a tick (each record takes about
+// 500 bytes).
+const int kReceiveBufferSize{4 << 20};
+// Size of the buffer each datagram is read into.
+const std::size_t kDatagramSize{64 << 10};
+
+// Send a generic netlink request with a single attribute. The kernel
+// acknowledges it, so its errors can be read from the socket.
+bool SendRequest(int socket, std::uint16_t family, std::uint8_t command,
+                 std::uint16_t attribute, const void* data, std::size_t size) {
+  struct {
+    nlmsghdr header;
+    genlmsghdr generic;
+    char attributes[256];
+  } request{};
+  if (NLA_HDRLEN + size > sizeof(request.attributes)) {
+    return false;
+  }
+  nlattr* header{reinterpret_cast<nlattr*>(request.attributes)};
+  header->nla_type = attribute;
+  header->nla_len = static_cast<std::uint16_t>(NLA_HDRLEN + size);
+  std::memcpy(request.attributes + NLA_HDRLEN, data, size);
+  request.header.nlmsg_len =
+      NLMSG_LENGTH(GENL_HDRLEN + NLA_ALIGN(header->nla_len));
+  request.header.nlmsg_type = family;
+  request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+  request.generic.cmd = command;
+  request.generic.version = 1;
+  sockaddr_nl kernel{};
+  kernel.nl_family = AF_NETLINK;
+  const ssize_t sent{sendto(socket, &request, request.header.nlmsg_len, 0,
+                            reinterpret_cast<sockaddr*>(&kernel),
+                            sizeof(kernel))};
+  return sent == static_cast<ssize_t>(request.header.nlmsg_len);
+}
+
+// Call a function with the type, payload and payload size of each attribute
+// in a buffer.
+template <typename Function>
+void ForEachAttribute(const char* attributes, std::size_t size,
+                      Function&& function) {
+  while (size >= NLA_HDRLEN) {
+    const nlattr* header{reinterpret_cast<const nlattr*>(attributes)};
+    if (header->nla_len < NLA_HDRLEN || header->nla_len > size) {
+      return;
+    }
+    function(header->nla_type & NLA_TYPE_MASK, attributes + NLA_HDRLEN,
+             static_cast<std::size_t>(header->nla_len - NLA_HDRLEN));
+    const std::size_t length{
+        std::min<std::size_t>(NLA_ALIGN(header->nla_len), size)};
+    attributes += length;
+    size -= length;
+  }
+}
+
+#endif
+
+}  // namespace
+
+ExitAccounting::ExitAccounting() = default;
+
+ExitAccounting::~ExitAccounting() {
+  if (socket_ >= 0) {
+    close(socket_);
+  }
+}
+
+bool ExitAccounting::Enable(const std::chrono::steady_clock::time_point now) {
+#ifdef HAS_TASKSTATS
+  if (Enabled()) {
+    return true;
+  }
+  socket_ = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC);
+  if (socket_ < 0) {
+    return false;
+  }
+  // The requests below wait for their acknowledgment, but not forever.
+  const timeval timeout{1, 0};
+  setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(socket_, SOL_SOCKET, SO_RCVBUF, &kReceiveBufferSize,
+             sizeof(kReceiveBufferSize));
+  sockaddr_nl local{};
+  local.nl_family = AF_NETLINK;
+  buffer_.resize(kDatagramSize);
+  now_ = now;
+  last_update_ = now;
+
+  // The taskstats family id is assigned dynamically, so it is requested to the
+  // controller first. Then we register for the records of all the possible
+  // CPUs (e.g. "0-63"), including the ones that are offline now.
+  static const char kFamilyName[]{TASKSTATS_GENL_NAME};
+  const std::string cpus{
+      "0-" + std::to_string(std::max(sysconf(_SC_NPROCESSORS_CONF), 1L) - 1)};
+  if (bind(socket_, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0 ||
+      !SendRequest(socket_, GENL_ID_CTRL, CTRL_CMD_GETFAMILY,
+                   CTRL_ATTR_FAMILY_NAME, kFamilyName, sizeof(kFamilyName)) ||
+      Receive(true) != 0 || family_ == 0 ||
+      !SendRequest(socket_, family_, TASKSTATS_CMD_GET,
+                   TASKSTATS_CMD_ATTR_REGISTER_CPUMASK, cpus.c_str(),
+                   cpus.size() + 1) ||
+      Receive(true) != 0) {
+    close(socket_);
+    socket_ = -1;
+    family_ = 0;
+    return false;
+  }
+  return true;
+#else
+  (void)now;
+  return false;
+#endif
+}
+
+bool ExitAccounting::Enabled() const { return socket_ >= 0 && family_ != 0; }
+
+void ExitAccounting::Update(const std::chrono::steady_clock::time_point now) {
+  if (!Enabled() || now == now_) {
+    return;
+  }
+  now_ = now;
+  // The collector can be enabled after the time point of the tick was taken.
+  interval_ = std::max(now - last_update_,
+                       std::chrono::steady_clock::duration::zero());
+  for (auto& [command, stats] : commands_) {
+    stats.interval_cpu_seconds = 0;
+  }
+  current_ = {};
+  Receive(false);
+
+  // The CPU shares are relative to all the online CPUs.
+  const double capacity{
+      std::chrono::duration<double>(interval_).count() *
+      static_cast<double>(std::max(sysconf(_SC_NPROCESSORS_ONLN), 1L))};
+  const auto share = [capacity](double cpu_seconds) {
+    return capacity > 0
+               ? static_cast<float>(std::min(cpu_seconds / capacity, 1.0))
+               : 0.0f;
+  };
+  current_.cpu_utilization = share(current_.cpu_seconds);
+  last_interval_ = current_;
+  last_update_ = std::max(now, last_update_);
+  for (auto it = commands_.begin(); it != commands_.end();) {
+    if (now - it->second.last_exit > kRecentWindow) {
+      it = commands_.erase(it);
+      continue;
+    }
+    it->second.cpu_utilization = share(it->second.interval_cpu_seconds);
+    ++it;
+  }
+}
+
+const std::vector<const ExitedCommand*>& ExitAccounting::Busiest(
+    const std::size_t n) {
+  busiest_.clear();
+  for (const auto& [command, stats] : commands_) {
+    busiest_.push_back(&stats);
+  }
+  // Only the first n commands need to be sorted.
+  const auto middle = busiest_.begin() + std::min(n, busiest_.size());
+  std::partial_sort(busiest_.begin(), middle, busiest_.end(),
+                    [](const ExitedCommand* a, const ExitedCommand* b) {
+                      return a->cpu_seconds > b->cpu_seconds;
+                    });
+  busiest_.erase(middle, busiest_.end());
+  return busiest_;
+}
+
+const ExitInterval& ExitAccounting::LastInterval() const {
+  return last_interval_;
+}
+
+std::uint64_t ExitAccounting::Overruns() const { return overruns_; }
+
+int ExitAccounting::Receive(const bool wait_ack) {
+#ifdef HAS_TASKSTATS
+  while (true) {
+    const ssize_t received{
+        recv(socket_, buffer_.data(), buffer_.size(),
+             wait_ack ? 0 : MSG_DONTWAIT)};
+    if (received < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // The kernel drops the records that don't fit in the socket buffer,
+      // and reports it once. The socket keeps working.
+      if (errno == ENOBUFS) {
+        ++overruns_;
+        continue;
+      }
+      return wait_ack ? -errno : 0;
+    }
+    // NLMSG_OK() and NLMSG_NEXT() work with a signed size.
+    int size{static_cast<int>(received)};
+    for (const nlmsghdr* message{
+             reinterpret_cast<const nlmsghdr*>(buffer_.data())};
+         NLMSG_OK(message, size); message = NLMSG_NEXT(message, size)) {
+      if (message->nlmsg_type == NLMSG_ERROR) {
+        const nlmsgerr* error{
+            static_cast<const nlmsgerr*>(NLMSG_DATA(message))};
+        if (wait_ack) {
+          return error->error;
+        }
+        continue;
+      }
+      if (message->nlmsg_len < NLMSG_LENGTH(GENL_HDRLEN)) {
+        continue;
+      }
+      const char* attributes{static_cast<const char*>(NLMSG_DATA(message)) +
+                             GENL_HDRLEN};
+      const std::size_t attributes_size{message->nlmsg_len -
+                                        NLMSG_LENGTH(GENL_HDRLEN)};
+      if (message->nlmsg_type == GENL_ID_CTRL) {
+        HandleFamily(attributes, attributes_size);
+      } else if (family_ != 0 && message->nlmsg_type == family_) {
+        HandleStats(attributes, attributes_size);
+      }
+    }
+  }
+#else
+  (void)wait_ack;
+  return 0;
+#endif
+}
+
+void ExitAccounting::HandleFamily(const char* attributes,
+                                  const std::size_t size) {
+#ifdef HAS_TASKSTATS
+  ForEachAttribute(attributes, size,
+                   [this](int type, const char* payload, std::size_t length) {
+                     if (type == CTRL_ATTR_FAMILY_ID &&
+                         length >= sizeof(family_)) {
+                       std::memcpy(&family_, payload, sizeof(family_));
+                     }
+                   });
+#else
+  (void)attributes;
+  (void)size;
+#endif
+}
+
+void ExitAccounting::HandleStats(const char* attributes,
+                                 const std::size_t size) {
+#ifdef HAS_TASKSTATS
+  // Every task that exits sends a record with its own usage. When the last
+  // thread of a multithreaded process exits, the sum of its threads is sent
+  // too, which is ignored since they were already counted.
+  ForEachAttribute(attributes, size, [this](int type, const char* payload,
+                                            std::size_t length) {
+    if (type != TASKSTATS_TYPE_AGGR_PID) {
+      return;
+    }
+    ForEachAttribute(payload, length, [this](int nested_type,
+                                             const char* stats_payload,
+                                             std::size_t stats_length) {
+      if (nested_type != TASKSTATS_TYPE_STATS) {
+        return;
+      }
+      // The structure only grows between kernel versions, so the fields a
+      // kernel doesn't have are left at zero.
+      taskstats stats{};
+      std::memcpy(&stats, stats_payload, std::min(stats_length, sizeof(stats)));
+      stats.ac_comm[sizeof(stats.ac_comm) - 1] = '\0';
+      const double cpu_seconds{
+          static_cast<double>(stats.ac_utime + stats.ac_stime) / 1e6};
+      // The tasks that lived longer than the interval used only part of
+      // their CPU time in it.
+      const double interval_us{
+          std::chrono::duration<double, std::micro>(interval_).count()};
+      const double interval_share{
+          stats.ac_etime > interval_us ? interval_us / stats.ac_etime : 1.0};
+      const bool process_exit{stats.ac_tgid == 0 ||
+                              stats.ac_pid == stats.ac_tgid};
+
+      ExitedCommand& command{commands_[stats.ac_comm]};
+      if (command.command.empty()) {
+        command.command = stats.ac_comm;
+      }
+      command.exits += process_exit ? 1 : 0;
+      command.cpu_seconds += cpu_seconds;
+      command.interval_cpu_seconds += cpu_seconds * interval_share;
+      command.peak_rss_kilobytes =
+          std::max<std::uint64_t>(command.peak_rss_kilobytes,
+                                  stats.hiwater_rss);
+      command.read_bytes += stats.read_bytes;
+      command.write_bytes += stats.write_bytes;
+      command.last_exit = now_;
+      current_.exits += process_exit ? 1 : 0;
+      current_.cpu_seconds += cpu_seconds * interval_share;
+    });
+  });
+#else
+  (void)attributes;
+  (void)size;
+#endif
+}
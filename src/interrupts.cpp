@@ -0,0 +1,334 @@
+#include "interrupts.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "parser_helper.h"
+
+namespace {
+
+// Sources with fewer interrupts per second are never imbalanced, since a few
+// interrupts are usually handled by a single CPU.
+const float kMinImbalanceRate{100};
+
+// Remove the whitespace around a text.
+std::string_view Trim(std::string_view text) {
+  const std::size_t begin{text.find_first_not_of(" \t")};
+  if (begin == std::string_view::npos) {
+    return {};
+  }
+  const std::size_t end{text.find_last_not_of(" \t")};
+  return text.substr(begin, end - begin + 1);
+}
+
+// Parse the next field as a counter, consuming it only if it is a number.
+bool NextCounter(parser_helper::FieldTokenizer& tokenizer,
+                 std::uint64_t& value) {
+  parser_helper::FieldTokenizer next{tokenizer};
+  const std::string_view field{next.Next()};
+  const auto result =
+      std::from_chars(field.data(), field.data() + field.size(), value);
+  if (field.empty() || result.ec != std::errc{} ||
+      result.ptr != field.data() + field.size()) {
+    return false;
+  }
+  tokenizer = next;
+  return true;
+}
+
+}  // namespace
+
+InterruptMatrix::InterruptMatrix(std::string path) : path_{std::move(path)} {}
+
+void InterruptMatrix::Update(const double elapsed_seconds,
+                             std::pmr::memory_resource* resource) {
+  std::pmr::string content{resource};
+  if (!parser_helper::TryReadFile(path_.c_str(), content)) {
+    cpu_count_ = 0;
+    cpu_ids_.clear();
+    cpu_columns_.clear();
+    sources_.clear();
+    counts_.clear();
+    rates_.clear();
+    return;
+  }
+  std::string_view text{content};
+  const std::size_t header_end{std::min(text.find('\n'), text.size())};
+
+  // The header has the ids of the online CPUs (e.g. "CPU0 CPU1 CPU3"). When
+  // they change, the counts of the previous columns are discarded.
+  parser_helper::FieldTokenizer header{text.substr(0, header_end)};
+  int cpus{0};
+  bool cpus_changed{false};
+  for (std::string_view field{header.Next()}; !field.empty();
+       field = header.Next()) {
+    int id{cpus};
+    if (field.substr(0, 3) == "CPU") {
+      std::from_chars(field.data() + 3, field.data() + field.size(), id);
+    }
+    if (cpus >= static_cast<int>(cpu_ids_.size())) {
+      cpu_ids_.push_back(id);
+      cpus_changed = true;
+    } else if (cpu_ids_[cpus] != id) {
+      cpu_ids_[cpus] = id;
+      cpus_changed = true;
+    }
+    ++cpus;
+  }
+  cpus_changed = cpus_changed || cpus != cpu_count_;
+  cpu_ids_.resize(cpus);
+  cpu_count_ = cpus;
+  if (cpus_changed) {
+    sources_.clear();
+    counts_.clear();
+    rates_.clear();
+    cpu_columns_.assign(
+        cpus > 0 ? *std::max_element(cpu_ids_.begin(), cpu_ids_.end()) + 1 : 0,
+        -1);
+    for (int column = 0; column < cpus; ++column) {
+      if (cpu_ids_[column] >= 0) {
+        cpu_columns_[cpu_ids_[column]] = column;
+      }
+    }
+  }
+  if (cpus == 0) {
+    return;
+  }
+  const std::size_t row_size{static_cast<std::size_t>(cpus)};
+
+  // Each line has the format "<name>: <count per CPU> <description>". Some
+  // lines have a single count (e.g. "ERR: 0"). The sources are usually in the
+  // same order in every update, so matching them with the previous update is
+  // cheap.
+  std::size_t count{0};
+  text.remove_prefix(std::min(header_end + 1, text.size()));
+  parser_helper::ForEachLine(text, [&](std::string_view line) {
+    const std::size_t separator{line.find(':')};
+    if (separator == std::string_view::npos) {
+      return;
+    }
+    const std::string_view name{Trim(line.substr(0, separator))};
+    auto found = count < sources_.size() && sources_[count].name == name
+                     ? sources_.begin() + count
+                     : std::find_if(sources_.begin() + count, sources_.end(),
+                                    [name](const InterruptSource& source) {
+                                      return source.name == name;
+                                    });
+    const bool new_source{found == sources_.end()};
+    const std::size_t found_row{
+        static_cast<std::size_t>(found - sources_.begin())};
+    if (new_source) {
+      InterruptSource source{};
+      source.name = std::string{name};
+      found = sources_.insert(sources_.begin() + count, std::move(source));
+      counts_.insert(counts_.begin() + count * row_size, row_size, 0);
+      rates_.insert(rates_.begin() + count * row_size, row_size, 0);
+    } else if (found_row != count) {
+      std::rotate(sources_.begin() + count, found, found + 1);
+      std::rotate(counts_.begin() + count * row_size,
+                  counts_.begin() + found_row * row_size,
+                  counts_.begin() + (found_row + 1) * row_size);
+      std::rotate(rates_.begin() + count * row_size,
+                  rates_.begin() + found_row * row_size,
+                  rates_.begin() + (found_row + 1) * row_size);
+      found = sources_.begin() + count;
+    }
+    InterruptSource& source{*found};
+    std::uint64_t* counts{counts_.data() + count * row_size};
+    float* rates{rates_.data() + count * row_size};
+    ++count;
+
+    // The first counts of a source found after the first update are only
+    // stored, since they were not accumulated in the interval.
+    const bool calculate_rates{!new_source || !updated_};
+    parser_helper::FieldTokenizer tokenizer{line.substr(separator + 1)};
+    std::uint64_t total{0};
+    std::uint64_t busiest{0};
+    source.busiest_cpu = 0;
+    for (int cpu = 0; cpu < cpus; ++cpu) {
+      std::uint64_t value{0};
+      const bool present{NextCounter(tokenizer, value)};
+      const std::uint64_t delta{present && value >= counts[cpu]
+                                    ? value - counts[cpu]
+                                    : 0};
+      counts[cpu] = value;
+      rates[cpu] = calculate_rates && elapsed_seconds > 0
+                       ? static_cast<float>(delta / elapsed_seconds)
+                       : 0;
+      if (!calculate_rates) {
+        continue;
+      }
+      total += delta;
+      if (delta > busiest) {
+        busiest = delta;
+        source.busiest_cpu = cpu;
+      }
+    }
+    source.rate = calculate_rates && elapsed_seconds > 0
+                      ? static_cast<float>(total / elapsed_seconds)
+                      : 0;
+    source.busiest_share =
+        total > 0 ? static_cast<float>(busiest) / static_cast<float>(total)
+                  : 0;
+    const std::string_view description{Trim(tokenizer.Remaining())};
+    if (source.description != description) {
+      source.description.assign(description.data(), description.size());
+    }
+  });
+  sources_.resize(count);
+  counts_.resize(count * row_size);
+  rates_.resize(count * row_size);
+  updated_ = true;
+}
+
+int InterruptMatrix::CpuCount() const { return cpu_count_; }
+
+int InterruptMatrix::CpuId(const int cpu) const { return cpu_ids_[cpu]; }
+
+int InterruptMatrix::CpuColumn(const int cpu_id) const {
+  return cpu_id >= 0 && cpu_id < static_cast<int>(cpu_columns_.size())
+             ? cpu_columns_[cpu_id]
+             : -1;
+}
+
+const std::vector<InterruptSource>& InterruptMatrix::Sources() const {
+  return sources_;
+}
+
+float InterruptMatrix::Rate(const std::size_t source, const int cpu) const {
+  return rates_[source * static_cast<std::size_t>(cpu_count_) + cpu];
+}
+
+InterruptMonitor::InterruptMonitor(std::string interrupts_path,
+                                   std::string softirqs_path,
+                                   std::string stat_path)
+    : hardware_{std::move(interrupts_path)},
+      software_{std::move(softirqs_path)},
+      stat_path_{std::move(stat_path)} {}
+
+void InterruptMonitor::Update(const std::chrono::steady_clock::time_point now,
+                              std::pmr::memory_resource* resource) {
+  if (now == last_update_) {
+    return;
+  }
+  // In the first update we consider the time since the boot.
+  double elapsed_seconds{
+      std::chrono::duration<double>(now - last_update_).count()};
+  if (last_update_ == std::chrono::steady_clock::time_point{}) {
+    timespec boot_time{};
+    clock_gettime(CLOCK_BOOTTIME, &boot_time);
+    elapsed_seconds = boot_time.tv_sec + boot_time.tv_nsec / 1e9;
+  }
+  last_update_ = now;
+  hardware_.Update(elapsed_seconds, resource);
+  software_.Update(elapsed_seconds, resource);
+  UpdateCoreTimes(resource);
+}
+
+const InterruptMatrix& InterruptMonitor::Hardware() const { return hardware_; }
+
+const InterruptMatrix& InterruptMonitor::Software() const { return software_; }
+
+const std::vector<CoreInterruptTime>& InterruptMonitor::CoreTimes() const {
+  return core_times_;
+}
+
+const std::vector<InterruptSourceRef>& InterruptMonitor::Busiest(
+    const std::size_t n) {
+  busiest_.clear();
+  for (const InterruptMatrix* matrix : {&hardware_, &software_}) {
+    for (std::size_t i = 0; i < matrix->Sources().size(); ++i) {
+      if (matrix->Sources()[i].rate > 0) {
+        busiest_.push_back(InterruptSourceRef{matrix, i});
+      }
+    }
+  }
+  // Only the first n sources need to be sorted.
+  const auto middle = busiest_.begin() + std::min(n, busiest_.size());
+  std::partial_sort(busiest_.begin(), middle, busiest_.end(),
+                    [](const InterruptSourceRef& a,
+                       const InterruptSourceRef& b) {
+                      return a.Source().rate > b.Source().rate;
+                    });
+  busiest_.erase(middle, busiest_.end());
+  return busiest_;
+}
+
+void InterruptMonitor::SetImbalanceThreshold(const float threshold) {
+  imbalance_threshold_ = std::clamp(threshold, 0.0f, 1.0f);
+}
+
+float InterruptMonitor::ImbalanceThreshold() const {
+  return imbalance_threshold_;
+}
+
+bool InterruptMonitor::Imbalanced(const InterruptSource& source) const {
+  return hardware_.CpuCount() > 1 && source.rate >= kMinImbalanceRate &&
+         source.busiest_share > imbalance_threshold_;
+}
+
+void InterruptMonitor::UpdateCoreTimes(std::pmr::memory_resource* resource) {
+  std::pmr::string content{resource};
+  if (!parser_helper::TryReadFile(stat_path_.c_str(), content)) {
+    core_times_.clear();
+    core_jiffies_.clear();
+    return;
+  }
+  // The lines "cpu<N> <user> <nice> <system> <idle> <iowait> <irq> <softirq>
+  // <steal> ..." have the time spent by each online CPU, in clock ticks.
+  std::size_t cpus{0};
+  for (CoreInterruptTime& core_time : core_times_) {
+    core_time = CoreInterruptTime{};
+  }
+  parser_helper::ForEachLine(content, [&](std::string_view line) {
+    if (line.size() < 4 || line.substr(0, 3) != "cpu" || line[3] == ' ') {
+      return;
+    }
+    parser_helper::FieldTokenizer tokenizer{line};
+    const std::string_view name{tokenizer.Next()};
+    std::size_t cpu{0};
+    std::from_chars(name.data() + 3, name.data() + name.size(), cpu);
+    std::uint64_t total{0};
+    std::uint64_t irq{0};
+    std::uint64_t softirq{0};
+    for (int field = 0; field < 8; ++field) {
+      const std::uint64_t value{tokenizer.NextNumber<std::uint64_t>()};
+      total += value;
+      if (field == 5) {
+        irq = value;
+      } else if (field == 6) {
+        softirq = value;
+      }
+    }
+    if (cpu >= core_times_.size()) {
+      core_times_.resize(cpu + 1);
+      core_jiffies_.resize((cpu + 1) * 3);
+    }
+    std::uint64_t* previous{core_jiffies_.data() + cpu * 3};
+    const float elapsed{
+        static_cast<float>(total > previous[0] ? total - previous[0] : 0)};
+    const auto share = [elapsed](std::uint64_t current,
+                                 std::uint64_t last) {
+      return elapsed > 0 && current >= last
+                 ? std::min(static_cast<float>(current - last) / elapsed, 1.0f)
+                 : 0.0f;
+    };
+    core_times_[cpu].irq = share(irq, previous[1]);
+    core_times_[cpu].softirq = share(softirq, previous[2]);
+    previous[0] = total;
+    previous[1] = irq;
+    previous[2] = softirq;
+    cpus = std::max(cpus, cpu + 1);
+  });
+  core_times_.resize(cpus);
+  core_jiffies_.resize(cpus * 3);
+}
@@ -1,7 +1,90 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include "metrics_exporter.h"
 #include "ncurses_display.h"
+#include "snapshot_publisher.h"
 #include "system.h"
 
-int main() {
+// Usage:
+//   monitor [--cpu-budget <percent>] [--irq-imbalance <percent>] [--exits]
+//                      Sample "/proc" and show the UI. The monitor reduces its
+//                      work to keep its own CPU usage under the budget, as a
+//                      percentage of one core (1 by default). The interrupts
+//                      view highlights the sources with more than the
+//                      imbalance percentage in one CPU (80 by default). With
+//                      --exits the processes that exit are accounted from the
+//                      start, including the ones that live less than a tick
+//                      (it needs CAP_NET_ADMIN).
+//   monitor --publish [--metrics <port | unix:path>]
+//                     [--metrics-max-series <n>] [--io-uring]
+//                      Sample "/proc" once per second and publish the
+//                      snapshots in shared memory, without UI. With --metrics
+//                      the snapshots are also served in the OpenMetrics format
+//                      in a loopback TCP port or a Unix socket, with the
+//                      series of the n processes with the highest CPU
+//                      utilization (50 by default). With --io-uring the
+//                      process files are read in batches with io_uring, when
+//                      the kernel supports it.
+//   monitor --attach   Show the UI with the snapshots of a publisher.
+int main(int argc, char* argv[]) {
+  if (argc > 1 && std::strcmp(argv[1], "--publish") == 0) {
+    System system;
+    SnapshotPublisher publisher{};
+    std::unique_ptr<MetricsExporter> exporter{};
+    const char* metrics_endpoint{nullptr};
+    std::size_t max_process_series{50};
+    for (int i = 2; i < argc; ++i) {
+      if (std::strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+        metrics_endpoint = argv[++i];
+      } else if (std::strcmp(argv[i], "--metrics-max-series") == 0 &&
+                 i + 1 < argc) {
+        max_process_series = std::strtoul(argv[++i], nullptr, 10);
+      } else if (std::strcmp(argv[i], "--io-uring") == 0 &&
+                 !system.EnableIoUring()) {
+        std::cerr << "io_uring is not available, reading files synchronously"
+                  << std::endl;
+      }
+    }
+    if (metrics_endpoint != nullptr) {
+      exporter = std::make_unique<MetricsExporter>(
+          MetricsExporter::ParseEndpoint(metrics_endpoint),
+          max_process_series);
+    }
+    while (1) {
+      publisher.Publish(system);
+      if (exporter) {
+        exporter->Render(publisher.Latest());
+      }
+      system.EndTick();
+      // The publisher refreshes faster while the system is stalled.
+      system.Pressure().Wait(-1);
+    }
+  }
+  if (argc > 1 && std::strcmp(argv[1], "--attach") == 0) {
+    SnapshotReader reader{};
+    NCursesDisplay::Display(reader);
+    return 0;
+  }
+  // Taken before creating the system, so the startup times shown by the UI
+  // include it.
+  const auto start_time = std::chrono::steady_clock::now();
   System system;
-  NCursesDisplay::Display(system);
-}
\ No newline at end of file
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--cpu-budget") == 0 && i + 1 < argc) {
+      system.Governor().SetBudget(std::strtof(argv[++i], nullptr) / 100);
+    } else if (std::strcmp(argv[i], "--irq-imbalance") == 0 && i + 1 < argc) {
+      system.SetIrqImbalanceThreshold(std::strtof(argv[++i], nullptr) / 100);
+    } else if (std::strcmp(argv[i], "--exits") == 0 &&
+               !system.EnableExitAccounting()) {
+      std::cerr << "taskstats is not available, exited processes are not "
+                   "accounted"
+                << std::endl;
+    }
+  }
+  NCursesDisplay::Display(system, start_time);
+}
@@ -0,0 +1,83 @@
+#include "metric_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+#include "process.h"
+
+using std::chrono::steady_clock;
+
+ExpensiveMetricScheduler::ExpensiveMetricScheduler(
+    const std::chrono::microseconds budget,
+    const std::chrono::milliseconds refresh_interval,
+    const std::chrono::milliseconds stale_after)
+    : budget_{budget},
+      refresh_interval_{refresh_interval},
+      stale_after_{stale_after} {}
+
+void ExpensiveMetricScheduler::Run(std::vector<Process>& processes,
+                                   const std::size_t priority_first,
+                                   const std::size_t priority_count,
+                                   const steady_clock::time_point now,
+                                   std::pmr::memory_resource* resource) {
+  if (processes.empty()) {
+    return;
+  }
+  // The budget is measured with the real clock, since the reads are what we
+  // are limiting. A clock read is cheap compared to one of them.
+  const steady_clock::time_point deadline{steady_clock::now() + budget_};
+  const auto refresh = [&](Process& process) {
+    const steady_clock::time_point sampled_at{process.MemoryDetailSampledAt()};
+    if (sampled_at != steady_clock::time_point{} &&
+        now - sampled_at < refresh_interval_) {
+      return true;
+    }
+    process.UpdateMemoryDetail(now, resource);
+    return steady_clock::now() < deadline;
+  };
+
+  const std::size_t priority_begin{std::min(priority_first, processes.size())};
+  const std::size_t priority_end{
+      std::min(priority_begin + priority_count, processes.size())};
+  for (std::size_t i = priority_begin; i < priority_end; ++i) {
+    if (!refresh(processes[i])) {
+      return;
+    }
+  }
+  // The other processes are refreshed oldest value first. The list is sorted
+  // by other criteria every tick and processes come and go, so the order is
+  // taken from the sampling times instead of the positions in the list.
+  std::pmr::vector<Process*> pending{resource};
+  for (std::size_t i = 0; i < processes.size(); ++i) {
+    const steady_clock::time_point sampled_at{
+        processes[i].MemoryDetailSampledAt()};
+    if ((i < priority_begin || i >= priority_end) &&
+        (sampled_at == steady_clock::time_point{} ||
+         now - sampled_at >= refresh_interval_)) {
+      pending.push_back(&processes[i]);
+    }
+  }
+  // Only the processes that fit in the budget are taken from the heap, so the
+  // list is not sorted in full.
+  const auto newer = [](const Process* a, const Process* b) {
+    return a->MemoryDetailSampledAt() > b->MemoryDetailSampledAt();
+  };
+  std::make_heap(pending.begin(), pending.end(), newer);
+  while (!pending.empty()) {
+    std::pop_heap(pending.begin(), pending.end(), newer);
+    if (!refresh(*pending.back())) {
+      return;
+    }
+    pending.pop_back();
+  }
+}
+
+bool ExpensiveMetricScheduler::IsStale(
+    const steady_clock::time_point sampled_at,
+    const steady_clock::time_point now) const {
+  return sampled_at == steady_clock::time_point{} ||
+         now - sampled_at > stale_after_;
+}
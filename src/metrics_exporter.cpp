@@ -0,0 +1,317 @@
+#include "metrics_exporter.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "errors.h"
+#include "format.h"
+
+namespace {
+
+// Append a label value escaping the characters that are special in the
+// OpenMetrics text format.
+void AppendLabelValue(std::string& output, std::string_view value) {
+  for (const char character : value) {
+    switch (character) {
+      case '\\':
+        output += "\\\\";
+        break;
+      case '"':
+        output += "\\\"";
+        break;
+      case '\n':
+        output += "\\n";
+        break;
+      default:
+        output += character;
+    }
+  }
+}
+
+// Append the labels that identify a process series. Only the executable of the
+// command line is used, since the arguments would make the labels too large.
+void AppendProcessLabels(std::string& output,
+                         const snapshot::ProcessRecord& process) {
+  std::string_view command{snapshot::FieldView(process.command)};
+  command = command.substr(0, command.find(' '));
+  fmt::format_to(std::back_inserter(output), "{{pid=\"{}\",user=\"",
+                 process.pid);
+  AppendLabelValue(output, snapshot::FieldView(process.user));
+  output += "\",command=\"";
+  AppendLabelValue(output, command);
+  output += "\"}";
+}
+
+void AppendMetricHeader(std::string& output, std::string_view name,
+                        std::string_view type, std::string_view help) {
+  fmt::format_to(std::back_inserter(output), "# TYPE {} {}\n# HELP {} {}\n",
+                 name, type, name, help);
+}
+
+// Send all the buffers to a socket, handling partial writes. It returns false
+// if the peer closed the connection (EPIPE or ECONNRESET), in which case the
+// scrape is dropped. The data is sent with MSG_NOSIGNAL, since the SIGPIPE
+// raised by writing to a closed socket would kill the publisher.
+bool WriteAll(const int fd, iovec* buffers, int count) {
+  while (count > 0) {
+    msghdr message{};
+    message.msg_iov = buffers;
+    message.msg_iovlen = static_cast<std::size_t>(count);
+    const ssize_t written{sendmsg(fd, &message, MSG_NOSIGNAL)};
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    std::size_t remaining{static_cast<std::size_t>(written)};
+    while (count > 0 && remaining >= buffers->iov_len) {
+      remaining -= buffers->iov_len;
+      ++buffers;
+      --count;
+    }
+    if (count > 0) {
+      buffers->iov_base = static_cast<char*>(buffers->iov_base) + remaining;
+      buffers->iov_len -= remaining;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+MetricsExporter::Endpoint MetricsExporter::ParseEndpoint(
+    const std::string& description) {
+  const std::string_view kUnixPrefix{"unix:"};
+  Endpoint endpoint{};
+  if (description.compare(0, kUnixPrefix.size(), kUnixPrefix) == 0) {
+    endpoint.unix_socket_path = description.substr(kUnixPrefix.size());
+    if (endpoint.unix_socket_path.empty()) {
+      throw UnexpectedFormatError{"The Unix socket path is empty."};
+    }
+    return endpoint;
+  }
+  std::size_t parsed_size{0};
+  try {
+    endpoint.port = std::stoi(description, &parsed_size);
+  } catch (const std::logic_error&) {
+    parsed_size = 0;
+  }
+  if (parsed_size != description.size() || endpoint.port <= 0 ||
+      endpoint.port > 65535) {
+    throw UnexpectedFormatError{std::format(
+        "Invalid metrics endpoint '{}'. Expected a port or unix:<path>.",
+        description)};
+  }
+  return endpoint;
+}
+
+MetricsExporter::MetricsExporter(const Endpoint& endpoint,
+                                 const std::size_t max_process_series)
+    : endpoint_{endpoint},
+      max_process_series_{max_process_series},
+      body_{std::make_shared<std::string>("# EOF\n")} {
+  const std::string description{
+      endpoint.unix_socket_path.empty()
+          ? std::format("127.0.0.1:{}", endpoint.port)
+          : endpoint.unix_socket_path};
+  int bind_result{-1};
+  if (endpoint.unix_socket_path.empty()) {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ >= 0) {
+      const int reuse_address{1};
+      setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse_address,
+                 sizeof(reuse_address));
+      sockaddr_in address{};
+      address.sin_family = AF_INET;
+      address.sin_port = htons(static_cast<uint16_t>(endpoint.port));
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      bind_result = bind(listen_fd_, reinterpret_cast<sockaddr*>(&address),
+                         sizeof(address));
+    }
+  } else {
+    sockaddr_un address{};
+    if (endpoint.unix_socket_path.size() >= sizeof(address.sun_path)) {
+      throw UnexpectedFormatError{
+          std::format("The Unix socket path is too long: {}", description)};
+    }
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ >= 0) {
+      address.sun_family = AF_UNIX;
+      std::strcpy(address.sun_path, endpoint.unix_socket_path.c_str());
+      unlink(address.sun_path);
+      bind_result = bind(listen_fd_, reinterpret_cast<sockaddr*>(&address),
+                         sizeof(address));
+    }
+  }
+  if (bind_result != 0 || listen(listen_fd_, 16) != 0) {
+    if (listen_fd_ >= 0) {
+      close(listen_fd_);
+    }
+    throw OpenFileError{description};
+  }
+  server_ = std::thread{&MetricsExporter::Serve, this};
+}
+
+MetricsExporter::~MetricsExporter() {
+  stop_ = true;
+  server_.join();
+  close(listen_fd_);
+  if (!endpoint_.unix_socket_path.empty()) {
+    unlink(endpoint_.unix_socket_path.c_str());
+  }
+}
+
+void MetricsExporter::Render(const snapshot::SnapshotView& view) {
+  // Reuse the buffer of the body before the last one if no scrape is still
+  // sending it.
+  std::shared_ptr<std::string> body{};
+  {
+    std::lock_guard<std::mutex> lock{body_mutex_};
+    body.swap(spare_body_);
+  }
+  if (!body || body.use_count() != 1) {
+    body = std::make_shared<std::string>();
+  }
+  std::string& output{*body};
+  output.clear();
+  auto out = std::back_inserter(output);
+
+  const snapshot::SystemRecord& system{view.System()};
+  AppendMetricHeader(output, "monitor_cpu_utilization", "gauge",
+                     "Fraction of the CPU time spent doing work.");
+  fmt::format_to(out, "monitor_cpu_utilization {}\n", system.cpu_utilization);
+  AppendMetricHeader(output, "monitor_memory_utilization", "gauge",
+                     "Fraction of the memory in use.");
+  fmt::format_to(out, "monitor_memory_utilization {}\n",
+                 system.memory_utilization);
+  AppendMetricHeader(output, "monitor_processes_created", "counter",
+                     "Number of processes created since boot.");
+  fmt::format_to(out, "monitor_processes_created_total {}\n",
+                 system.total_processes);
+  AppendMetricHeader(output, "monitor_processes_running", "gauge",
+                     "Number of processes in the running state.");
+  fmt::format_to(out, "monitor_processes_running {}\n",
+                 system.running_processes);
+  AppendMetricHeader(output, "monitor_uptime_seconds", "gauge",
+                     "Time since the system boot.");
+  fmt::format_to(out, "monitor_uptime_seconds {}\n", system.uptime_seconds);
+
+  // Only the processes using more CPU are exported, to limit the number of
+  // series created by short lived processes.
+  const snapshot::ProcessRecord* processes{view.Processes()};
+  std::vector<std::uint32_t>& indexes{process_order_};
+  indexes.resize(view.ProcessCount());
+  std::iota(indexes.begin(), indexes.end(), 0);
+  const std::size_t series{std::min(max_process_series_, indexes.size())};
+  std::partial_sort(indexes.begin(), indexes.begin() + series, indexes.end(),
+                    [processes](std::uint32_t a, std::uint32_t b) {
+                      return processes[a].cpu_utilization >
+                             processes[b].cpu_utilization;
+                    });
+  AppendMetricHeader(output, "monitor_process_cpu_utilization", "gauge",
+                     "CPU utilization of the process (1 is all the CPUs fully "
+                     "used).");
+  for (std::size_t i = 0; i < series; ++i) {
+    output += "monitor_process_cpu_utilization";
+    AppendProcessLabels(output, processes[indexes[i]]);
+    fmt::format_to(out, " {}\n", processes[indexes[i]].cpu_utilization);
+  }
+  AppendMetricHeader(output, "monitor_process_resident_memory_bytes", "gauge",
+                     "Resident memory of the process.");
+  for (std::size_t i = 0; i < series; ++i) {
+    if (processes[indexes[i]].ram_kb < 0) {
+      continue;
+    }
+    output += "monitor_process_resident_memory_bytes";
+    AppendProcessLabels(output, processes[indexes[i]]);
+    fmt::format_to(out, " {}\n", processes[indexes[i]].ram_kb * 1024);
+  }
+  output += "# EOF\n";
+
+  std::lock_guard<std::mutex> lock{body_mutex_};
+  body_.swap(body);
+  spare_body_ = std::move(body);
+}
+
+void MetricsExporter::Serve() {
+  while (!stop_) {
+    // We poll with a timeout to notice when the exporter is being destroyed.
+    pollfd listen_poll{listen_fd_, POLLIN, 0};
+    if (poll(&listen_poll, 1, 200) <= 0) {
+      continue;
+    }
+    const int connection{accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC)};
+    if (connection < 0) {
+      continue;
+    }
+    // A client that doesn't send its request can't block the other scrapes
+    // for long.
+    const timeval kTimeout{1, 0};
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &kTimeout,
+               sizeof(kTimeout));
+    setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &kTimeout,
+               sizeof(kTimeout));
+    Answer(connection);
+    close(connection);
+  }
+}
+
+void MetricsExporter::Answer(const int connection) {
+  // We only need the request line, so we read until the end of the headers or
+  // until the buffer is full.
+  char request[1024];
+  std::size_t request_size{0};
+  while (request_size < sizeof(request)) {
+    const ssize_t bytes_read{recv(connection, request + request_size,
+                                  sizeof(request) - request_size, 0)};
+    if (bytes_read <= 0) {
+      break;
+    }
+    request_size += static_cast<std::size_t>(bytes_read);
+    if (std::string_view{request, request_size}.find("\r\n\r\n") !=
+        std::string_view::npos) {
+      break;
+    }
+  }
+  const std::string_view request_line{request, request_size};
+  const bool is_metrics_request{request_line.rfind("GET /metrics ", 0) == 0 ||
+                                request_line.rfind("GET /metrics?", 0) == 0};
+
+  std::shared_ptr<const std::string> body{};
+  if (is_metrics_request) {
+    std::lock_guard<std::mutex> lock{body_mutex_};
+    body = body_;
+  }
+  const std::string_view payload{body ? std::string_view{*body}
+                                      : std::string_view{"Not Found\n"}};
+  const std::string header{std::format(
+      "HTTP/1.1 {}\r\nContent-Type: {}\r\nContent-Length: {}\r\n"
+      "Connection: close\r\n\r\n",
+      body ? "200 OK" : "404 Not Found",
+      body ? "application/openmetrics-text; version=1.0.0; charset=utf-8"
+           : "text/plain",
+      payload.size())};
+  iovec buffers[2]{
+      {const_cast<char*>(header.data()), header.size()},
+      {const_cast<char*>(payload.data()), payload.size()},
+  };
+  // A client that closes the connection early only loses its own scrape.
+  WriteAll(connection, buffers, 2);
+}
@@ -1,13 +1,19 @@
 #include "ncurses_display.h"
 
 #include <curses.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <memory_resource>
 #include <string>
-#include <thread>
+#include <string_view>
 #include <vector>
 
 #include "format.h"
+#include "process_columns.h"
+#include "process_viewport.h"
 #include "system.h"
 
 using std::string;
@@ -18,91 +24,904 @@ class ScreenReseter {
  public:
   ~ScreenReseter() { endwin(); }
 };
+
+// The views of the bottom part of the screen.
+enum class View { kProcesses, kCgroups, kDisks, kInterrupts, kExitedTasks };
+
+// Shades of the heatmap cells, from the lowest to the highest value.
+const std::string_view kHeatShades{" .:-=+*#%@"};
+
+// Height of the basic system info section.
+const int kSystemWindowHeight{14};
+// Minimum height of the processes section: the borders, the header and a row.
+const int kMinProcessHeight{4};
+// Maximum number of digits typed in the jump to PID prompt.
+const std::size_t kMaxPidDigits{9};
+
+// Write a number in the "%f" format truncated to width characters, without
+// allocating memory.
+std::string_view TruncatedNumber(float value, std::size_t width,
+                                 std::array<char, 32>& buffer) {
+  const auto result = fmt::format_to_n(buffer.data(), buffer.size(), "{:f}",
+                                       value);
+  return std::string_view{buffer.data(),
+                          std::min({result.size, buffer.size(), width})};
+}
+
+// Call a function with a set of columns, extended with more columns if the
+// condition is true.
+template <typename Set, typename... Columns, typename Function>
+void AppendColumnsIf(bool condition, Function&& function) {
+  if (condition) {
+    function(typename Set::template Append<Columns...>{});
+  } else {
+    function(Set{});
+  }
+}
+
+// Call a function with the set of columns of the processes view options. One
+// variant of the function is compiled for each combination of the optional
+// columns.
+template <typename Function>
+void WithProcessColumns(const NCursesDisplay::ProcessViewOptions& options,
+                        Function&& function) {
+  using namespace process_columns;
+  const auto with_command = [&](auto columns) {
+    function(typename decltype(columns)::template Append<CommandColumn>{});
+  };
+  const auto with_cgroups = [&](auto columns) {
+    AppendColumnsIf<decltype(columns), CgroupColumn>(options.show_cgroups,
+                                                     with_command);
+  };
+  const auto with_sockets = [&](auto columns) {
+    AppendColumnsIf<decltype(columns), SocketsColumn>(options.show_sockets,
+                                                      with_cgroups);
+  };
+  const auto with_numa = [&](auto columns) {
+    AppendColumnsIf<decltype(columns), NumaColumn>(options.show_numa,
+                                                   with_sockets);
+  };
+  const auto with_scheduler_stats = [&](auto columns) {
+    AppendColumnsIf<decltype(columns), RunQueueDelayColumn,
+                    ContextSwitchesColumn>(options.show_scheduler_stats,
+                                           with_numa);
+  };
+  if (options.memory_detail != nullptr) {
+    with_scheduler_stats(ColumnSet<PidColumn, UserColumn, CpuColumn,
+                                   PssUssColumn, TimeColumn>{});
+  } else {
+    with_scheduler_stats(
+        ColumnSet<PidColumn, UserColumn, CpuColumn, RamColumn, TimeColumn>{});
+  }
+}
+
+// Mount the processes view with a set of columns (see DisplayProcesses).
+template <typename... Columns>
+void DisplayProcessColumns(process_columns::ColumnSet<Columns...> columns,
+                           std::vector<Process>& processes, WINDOW* window,
+                           int n, ProcessSortKey sort_key,
+                           const TickSample& sample,
+                           const NCursesDisplay::ProcessViewOptions& options,
+                           std::pmr::memory_resource* resource) {
+  const int first_column{2};
+  const int window_width{getmaxx(window)};
+  // The header of the column used to sort the processes is underlined.
+  wattron(window, COLOR_PAIR(2));
+  columns.ForEach(first_column, [&](auto column, int offset) {
+    using Column = decltype(column);
+    const attr_t attributes{Column::kSortable && Column::kSortKey == sort_key
+                                ? A_UNDERLINE
+                                : A_NORMAL};
+    wattron(window, attributes);
+    mvwaddstr(window, 1, offset, Column::kTitle);
+    wattroff(window, attributes);
+  });
+  wattroff(window, COLOR_PAIR(2));
+  const std::size_t first{std::min(options.first_row, processes.size())};
+  const int rows{
+      std::min(n, static_cast<int>(processes.size() - first))};
+  for (int i = 0; i < rows; ++i) {
+    const int row{i + 2};
+    Process& process{processes[first + i]};
+    const attr_t selection{process.Pid() == options.selected_pid ? A_REVERSE
+                                                                  : A_NORMAL};
+    wattron(window, selection);
+    mvwhline(window, row, first_column, ' ', window_width - 3);
+    // The files are read once per row, by the first column that needs them.
+    process_columns::ProcessFiles files{process.Pid(), resource};
+    process_columns::ColumnContext context{sample, files, resource,
+                                           options.memory_detail};
+    const bool detailed{i < options.detailed_rows};
+    columns.ForEach(first_column, [&](auto column, int offset) {
+      using Column = decltype(column);
+      // The metrics that need to read the process files are not sampled for
+      // the rows that are not detailed.
+      std::string_view text{"-"};
+      context.stale = false;
+      if (detailed || Column::kFiles == process_columns::kNoFile) {
+        Column::Update(process, context);
+        text = Column::Format(process, context);
+      }
+      const int width{Column::kWidth > 0 ? Column::kWidth - 1
+                                         : window_width - offset - 1};
+      if (context.stale) {
+        wattron(window, A_DIM);
+      }
+      mvwaddnstr(window, row, offset, text.data(),
+                 std::max(std::min(static_cast<int>(text.size()), width), 0));
+      wattroff(window, A_DIM);
+    });
+    wattroff(window, selection);
+  }
+}
+
+// Fit the windows to the terminal. The system section has a fixed height and
+// the processes section takes the rest.
+void FitWindows(WINDOW* system_window, WINDOW* process_window) {
+  const int width{std::max(getmaxx(stdscr) - 1, 1)};
+  wresize(system_window, kSystemWindowHeight, width);
+  wresize(process_window,
+          std::max(getmaxy(stdscr) - kSystemWindowHeight, kMinProcessHeight),
+          width);
+  mvwin(process_window, kSystemWindowHeight, 0);
+}
 }  // namespace
 
 // 50 bars uniformly displayed from 0 - 100 %
 // 2% is one bar(|)
-std::string NCursesDisplay::ProgressBar(float percent) {
-  std::string result{"0%"};
+std::pmr::string NCursesDisplay::ProgressBar(
+    float percent, std::pmr::memory_resource* resource) {
+  std::pmr::string result{"0%", resource};
   int size{50};
   float bars{percent * size};
+  result.reserve(size + 16);
 
   for (int i{0}; i < size; ++i) {
     result += i <= bars ? '|' : ' ';
   }
 
-  string display{to_string(percent * 100).substr(0, 4)};
-  if (percent < 0.1 || percent == 1.0)
-    display = " " + to_string(percent * 100).substr(0, 3);
-  return result + " " + display + "/100%";
+  std::array<char, 32> buffer{};
+  result += ' ';
+  if (percent < 0.1 || percent == 1.0) {
+    result += ' ';
+    result += TruncatedNumber(percent * 100, 3, buffer);
+  } else {
+    result += TruncatedNumber(percent * 100, 4, buffer);
+  }
+  result += "/100%";
+  return result;
 }
 
 void NCursesDisplay::DisplaySystem(System& system, WINDOW* window) {
+  std::pmr::memory_resource* resource{system.TickResource()};
   int row{0};
-  mvwprintw(window, ++row, 2, ("OS: " + system.OperatingSystem()).c_str());
-  mvwprintw(window, ++row, 2, ("Kernel: " + system.Kernel()).c_str());
+  mvwprintw(window, ++row, 2, "OS: %s", system.OperatingSystem().c_str());
+  mvwprintw(window, ++row, 2, "Kernel: %s", system.Kernel().c_str());
   mvwprintw(window, ++row, 2, "CPU: ");
   wattron(window, COLOR_PAIR(1));
-  mvwprintw(window, row, 10, "");
-  wprintw(window, ProgressBar(system.Cpu().Utilization()).c_str());
+  mvwaddstr(window, row, 10,
+            ProgressBar(system.CpuUtilization(), resource).c_str());
   wattroff(window, COLOR_PAIR(1));
+  const RunQueueStats run_queue{
+      system.Cpu().RunQueueDelay(system.Sample(), resource)};
+  if (run_queue.available) {
+    mvwprintw(window, ++row, 2, "Run queue delay: %.1f%% (%.2f ms/timeslice)",
+              run_queue.delay * 100, run_queue.delay_per_timeslice_ms);
+  } else {
+    mvwprintw(window, ++row, 2, "Run queue delay: n/a");
+  }
   mvwprintw(window, ++row, 2, "Memory: ");
   wattron(window, COLOR_PAIR(1));
-  mvwprintw(window, row, 10, "");
-  wprintw(window, ProgressBar(system.MemoryUtilization()).c_str());
+  mvwaddstr(window, row, 10,
+            ProgressBar(system.MemoryUtilization(), resource).c_str());
   wattroff(window, COLOR_PAIR(1));
-  mvwprintw(window, ++row, 2,
-            ("Total Processes: " + to_string(system.TotalProcesses())).c_str());
-  mvwprintw(
-      window, ++row, 2,
-      ("Running Processes: " + to_string(system.RunningProcesses())).c_str());
-  mvwprintw(window, ++row, 2,
-            ("Up Time: " + Format::ElapsedTime(system.UpTime())).c_str());
+  // Used and total memory of each NUMA node, and the fraction of its recent
+  // allocations that were for processes running in other nodes.
+  const std::vector<NumaNodeStats>& numa_nodes{system.NumaNodes()};
+  mvwprintw(window, ++row, 2, "NUMA:");
+  if (numa_nodes.empty()) {
+    wprintw(window, " n/a");
+  }
+  for (const NumaNodeStats& node : numa_nodes) {
+    wprintw(window, " N%d %.1f/%.1f GB (%.1f%% remote)", node.node,
+            (node.total_kb - node.free_kb) / 1048576.0,
+            node.total_kb / 1048576.0, node.remote_allocation_ratio * 100);
+  }
+  // Throughput of the interfaces with any traffic, while they fit in the row,
+  // and the TCP connections.
+  const NetworkMonitor& network{system.Network()};
+  mvwprintw(window, ++row, 2, "Network:");
+  const int network_width{getmaxx(window) - 2};
+  for (const InterfaceStats& interface : network.Interfaces()) {
+    if (interface.receive_bytes == 0 && interface.transmit_bytes == 0) {
+      continue;
+    }
+    if (getcurx(window) + 60 > network_width) {
+      wprintw(window, " ...");
+      break;
+    }
+    wprintw(window, " %s rx %.1f tx %.1f kB/s", interface.name.c_str(),
+            interface.receive_bytes_per_second / 1024,
+            interface.transmit_bytes_per_second / 1024);
+    if (interface.errors_per_second > 0 || interface.drops_per_second > 0) {
+      wprintw(window, " (%.0f err/s %.0f drop/s)", interface.errors_per_second,
+              interface.drops_per_second);
+    }
+  }
+  const TcpStats& tcp{network.Tcp()};
+  if (tcp.available) {
+    mvwprintw(window, ++row, 2,
+              "TCP: %lld established, %lld time-wait, %lld orphan, "
+              "%.1f/%.1f opens/s (active/passive), %.1f retrans/s",
+              tcp.established, tcp.time_wait, tcp.orphan,
+              tcp.active_opens_per_second, tcp.passive_opens_per_second,
+              tcp.retransmitted_segments_per_second);
+  } else {
+    mvwprintw(window, ++row, 2, "TCP: n/a");
+  }
+  // Percentage of the last 10 seconds in which some tasks were stalled.
+  const PressureMonitor& pressure{system.Pressure()};
+  const PressureStats cpu_pressure{pressure.Read(PressureResource::kCpu,
+                                                 resource)};
+  if (cpu_pressure.available) {
+    mvwprintw(window, ++row, 2,
+              "Pressure: CPU %.1f%% Memory %.1f%% IO %.1f%% (avg10)%s",
+              cpu_pressure.some_avg10,
+              pressure.Read(PressureResource::kMemory, resource).some_avg10,
+              pressure.Read(PressureResource::kIo, resource).some_avg10,
+              pressure.FastCaptureActive() ? " [fast capture]" : "");
+  } else {
+    mvwprintw(window, ++row, 2, "Pressure: n/a");
+  }
+  mvwprintw(window, ++row, 2, "Total Processes: %d", system.TotalProcesses());
+  // The processes that exited in the last interval, most of them between two
+  // scans, and the CPU they used in it.
+  const ExitAccounting& exited_tasks{system.ExitedTasks()};
+  if (exited_tasks.Enabled()) {
+    const ExitInterval& exits{exited_tasks.LastInterval()};
+    wprintw(window, " (%llu exited, %.1f%% CPU)",
+            static_cast<unsigned long long>(exits.exits),
+            exits.cpu_utilization * 100);
+  }
+  mvwprintw(window, ++row, 2, "Running Processes: %d",
+            system.RunningProcesses());
+  mvwprintw(window, ++row, 2, "Up Time: %s",
+            Format::ElapsedTime(system.UpTime()).c_str());
   wrefresh(window);
 }
 
-void NCursesDisplay::DisplayProcesses(std::vector<Process>& processes,
-                                      WINDOW* window, int n) {
+void NCursesDisplay::DisplayProcesses(
+    std::vector<Process>& processes, WINDOW* window, int n,
+    ProcessSortKey sort_key, const TickSample& sample,
+    const ProcessViewOptions& options, std::pmr::memory_resource* resource) {
+  WithProcessColumns(options, [&](auto columns) {
+    DisplayProcessColumns(columns, processes, window, n, sort_key, sample,
+                          options, resource);
+  });
+}
+
+void NCursesDisplay::DisplayCgroups(std::vector<Cgroup>& cgroups,
+                                    WINDOW* window, int n,
+                                    CgroupSortKey sort_key) {
+  int row{0};
+  int const cpu_column{2};
+  int const memory_column{11};
+  int const read_column{21};
+  int const write_column{33};
+  int const pids_column{46};
+  int const pressure_column{53};
+  int const name_column{68};
+  // The header of the column used to sort the groups is underlined.
+  const auto header = [window, sort_key](int column, const char* title,
+                                         CgroupSortKey key) {
+    const attr_t attributes{key == sort_key ? A_UNDERLINE : A_NORMAL};
+    wattron(window, attributes);
+    mvwaddstr(window, 1, column, title);
+    wattroff(window, attributes);
+  };
+  wattron(window, COLOR_PAIR(2));
+  header(cpu_column, "CPU[%]", CgroupSortKey::kCpu);
+  header(memory_column, "MEM[MB]", CgroupSortKey::kMemory);
+  header(read_column, "READ[KB/s]", CgroupSortKey::kIo);
+  header(write_column, "WRITE[KB/s]", CgroupSortKey::kIo);
+  header(pids_column, "PIDS", CgroupSortKey::kPids);
+  mvwaddstr(window, 1, pressure_column, "PSI[%]c/m/i");
+  header(name_column, "CGROUP", CgroupSortKey::kName);
+  wattroff(window, COLOR_PAIR(2));
+  ++row;
+  const int rows{std::min(n, static_cast<int>(cgroups.size()))};
+  std::array<char, 32> buffer{};
+  for (int i = 0; i < rows; ++i) {
+    const Cgroup& cgroup{cgroups[i]};
+    mvwhline(window, ++row, cpu_column, ' ', getmaxx(window) - 3);
+    const std::string_view cpu_text{
+        TruncatedNumber(cgroup.CpuUtilization() * 100, 4, buffer)};
+    mvwaddnstr(window, row, cpu_column, cpu_text.data(),
+               static_cast<int>(cpu_text.size()));
+    mvwprintw(window, row, memory_column, "%ld",
+              cgroup.MemoryBytes() / (1024 * 1024));
+    mvwprintw(window, row, read_column, "%.0f",
+              cgroup.ReadBytesPerSecond() / 1024);
+    mvwprintw(window, row, write_column, "%.0f",
+              cgroup.WriteBytesPerSecond() / 1024);
+    mvwprintw(window, row, pids_column, "%ld", cgroup.Pids());
+    mvwprintw(window, row, pressure_column, "%.0f/%.0f/%.0f",
+              cgroup.Pressure(PressureResource::kCpu),
+              cgroup.Pressure(PressureResource::kMemory),
+              cgroup.Pressure(PressureResource::kIo));
+    // The groups are indented according to their depth in the hierarchy.
+    const int indentation{2 * cgroup.Depth()};
+    const int width{
+        std::max(getmaxx(window) - name_column - indentation - 1, 0)};
+    const std::string_view name{cgroup.Name()};
+    mvwaddnstr(window, row, name_column + indentation, name.data(),
+               std::min(static_cast<int>(name.size()), width));
+  }
+}
+
+void NCursesDisplay::DisplayDisks(DiskMonitor& disks, WINDOW* window, int n,
+                                  DiskFilter filter) {
   int row{0};
+  int const device_column{2};
+  int const reads_column{14};
+  int const writes_column{23};
+  int const read_bytes_column{32};
+  int const write_bytes_column{41};
+  int const read_latency_column{50};
+  int const write_latency_column{59};
+  int const utilization_column{68};
+  wattron(window, COLOR_PAIR(2));
+  mvwaddstr(window, 1, device_column, "DEVICE");
+  mvwaddstr(window, 1, reads_column, "READ/s");
+  mvwaddstr(window, 1, writes_column, "WRITE/s");
+  mvwaddstr(window, 1, read_bytes_column, "RD[MB/s]");
+  mvwaddstr(window, 1, write_bytes_column, "WR[MB/s]");
+  mvwaddstr(window, 1, read_latency_column, "RD[ms]");
+  mvwaddstr(window, 1, write_latency_column, "WR[ms]");
+  mvwaddstr(window, 1, utilization_column, "UTIL[%]");
+  wattroff(window, COLOR_PAIR(2));
+  ++row;
+  // Only the shown devices are sorted, so hosts with hundreds of devices stay
+  // cheap.
+  const std::vector<const DiskStats*>& devices{
+      disks.Busiest(filter, static_cast<std::size_t>(std::max(n, 0)))};
+  std::array<char, 32> buffer{};
+  const auto number = [window, &buffer](int row, int column, float value,
+                                        int width) {
+    const std::string_view text{TruncatedNumber(value, width, buffer)};
+    mvwaddnstr(window, row, column, text.data(),
+               static_cast<int>(text.size()));
+  };
+  for (const DiskStats* device : devices) {
+    mvwhline(window, ++row, device_column, ' ', getmaxx(window) - 3);
+    mvwaddnstr(window, row, device_column, device->name.c_str(),
+               reads_column - device_column - 1);
+    number(row, reads_column, device->reads_per_second, 7);
+    number(row, writes_column, device->writes_per_second, 7);
+    number(row, read_bytes_column, device->read_bytes_per_second / 1e6f, 7);
+    number(row, write_bytes_column, device->write_bytes_per_second / 1e6f,
+           7);
+    number(row, read_latency_column, device->read_latency_ms, 7);
+    number(row, write_latency_column, device->write_latency_ms, 7);
+    number(row, utilization_column, device->utilization * 100, 5);
+  }
+  const char* filter_name{filter == DiskFilter::kPhysical     ? "physical"
+                          : filter == DiskFilter::kPartitions ? "partitions"
+                                                              : "all"};
+  mvwprintw(window, 0, 2, " disks: %s ", filter_name);
+}
+
+void NCursesDisplay::DisplayInterrupts(InterruptMonitor& interrupts,
+                                       WINDOW* window, int n) {
+  int const source_column{2};
+  int const rate_column{12};
+  int const heat_column{22};
+  // The busiest CPU of each source is shown after the heatmap.
+  int const busiest_width{16};
+  const int window_width{getmaxx(window)};
+  // The heatmap has the CPUs of "/proc/interrupts" (the online ones), and the
+  // other values are aligned to them by CPU id.
+  const InterruptMatrix& hardware{interrupts.Hardware()};
+  const int cpus{hardware.CpuCount()};
+  // Each cell of the heatmap has one or more CPUs, so that it fits in the
+  // window. A cell shows the highest value of its CPUs.
+  const int available_cells{
+      std::max(window_width - heat_column - busiest_width - 1, 1)};
+  const int cpus_per_cell{
+      std::max((cpus + available_cells - 1) / available_cells, 1)};
+  const int cells{(cpus + cpus_per_cell - 1) / cpus_per_cell};
+  int const busiest_column{heat_column + std::max(cells, 5) + 1};
+  const auto shade = [](float value) {
+    const float level{std::clamp(value, 0.0f, 1.0f) *
+                      static_cast<float>(kHeatShades.size() - 1)};
+    return kHeatShades[static_cast<std::size_t>(level + 0.5f)];
+  };
+  // Draw a row of cells, with the value of each CPU given by a function.
+  const auto heat_row = [&](int row, const auto& value) {
+    for (int cell = 0; cell < cells; ++cell) {
+      float highest{0};
+      for (int cpu = cell * cpus_per_cell;
+           cpu < std::min((cell + 1) * cpus_per_cell, cpus); ++cpu) {
+        highest = std::max(highest, value(cpu));
+      }
+      mvwaddch(window, row, heat_column + cell, shade(highest));
+    }
+  };
+
+  wattron(window, COLOR_PAIR(2));
+  mvwaddstr(window, 1, source_column, "SOURCE");
+  mvwaddstr(window, 1, rate_column, "RATE/s");
+  mvwaddstr(window, 1, heat_column, "CPUS");
+  mvwaddstr(window, 1, busiest_column, "BUSIEST");
+  wattroff(window, COLOR_PAIR(2));
+  // The time spent handling interrupts by each CPU, in absolute scale.
+  int row{1};
+  const std::vector<CoreInterruptTime>& core_times{interrupts.CoreTimes()};
+  const int core_count{static_cast<int>(core_times.size())};
+  mvwaddstr(window, ++row, source_column, "irq time");
+  heat_row(row, [&hardware, &core_times, core_count](int cpu) {
+    const int id{hardware.CpuId(cpu)};
+    return id >= 0 && id < core_count ? core_times[id].irq : 0.0f;
+  });
+  mvwaddstr(window, ++row, source_column, "softirq");
+  heat_row(row, [&hardware, &core_times, core_count](int cpu) {
+    const int id{hardware.CpuId(cpu)};
+    return id >= 0 && id < core_count ? core_times[id].softirq : 0.0f;
+  });
+  // The busiest sources, scaled to their busiest CPU. The sources mostly
+  // handled by one CPU are highlighted.
+  const int source_rows{std::max(n - 2, 0)};
+  for (const InterruptSourceRef& reference :
+       interrupts.Busiest(static_cast<std::size_t>(source_rows))) {
+    const InterruptSource& source{reference.Source()};
+    const InterruptMatrix& matrix{*reference.matrix};
+    const bool imbalanced{interrupts.Imbalanced(source)};
+    ++row;
+    const attr_t attributes{imbalanced ? COLOR_PAIR(3) | A_BOLD : A_NORMAL};
+    wattron(window, attributes);
+    mvwaddnstr(window, row, source_column, source.name.c_str(),
+               rate_column - source_column - 1);
+    wattroff(window, attributes);
+    mvwprintw(window, row, rate_column, "%.1f", source.rate);
+    const float busiest_rate{
+        matrix.Rate(reference.index, source.busiest_cpu)};
+    heat_row(row, [&hardware, &matrix, &reference, busiest_rate](int cpu) {
+      const int column{matrix.CpuColumn(hardware.CpuId(cpu))};
+      return column >= 0 && busiest_rate > 0
+                 ? matrix.Rate(reference.index, column) / busiest_rate
+                 : 0.0f;
+    });
+    wattron(window, attributes);
+    mvwprintw(window, row, busiest_column, "CPU%d %.0f%%",
+              matrix.CpuId(source.busiest_cpu), source.busiest_share * 100);
+    wattroff(window, attributes);
+  }
+  mvwprintw(window, 0, 2, " interrupts: ");
+  if (cpus > 0) {
+    wprintw(window, "CPU%d-%d", hardware.CpuId(0), hardware.CpuId(cpus - 1));
+    if (cpus_per_cell > 1) {
+      wprintw(window, " (%d per cell)", cpus_per_cell);
+    }
+    wprintw(window, ", ");
+  }
+  wprintw(window, "imbalance over %.0f%% ",
+          interrupts.ImbalanceThreshold() * 100);
+}
+
+void NCursesDisplay::DisplayExitedTasks(ExitAccounting& exited_tasks,
+                                        WINDOW* window, int n) {
+  if (!exited_tasks.Enabled()) {
+    mvwprintw(window, 0, 2,
+              " exited: not available (needs taskstats and CAP_NET_ADMIN) ");
+    return;
+  }
+  int row{0};
+  int const command_column{2};
+  int const exits_column{19};
+  int const cpu_time_column{27};
+  int const cpu_column{36};
+  int const rss_column{44};
+  int const read_column{53};
+  int const write_column{62};
+  int const age_column{71};
+  wattron(window, COLOR_PAIR(2));
+  mvwaddstr(window, 1, command_column, "COMMAND");
+  mvwaddstr(window, 1, exits_column, "EXITS");
+  mvwaddstr(window, 1, cpu_time_column, "CPU[s]");
+  mvwaddstr(window, 1, cpu_column, "CPU[%]");
+  mvwaddstr(window, 1, rss_column, "RSS[MB]");
+  mvwaddstr(window, 1, read_column, "RD[MB]");
+  mvwaddstr(window, 1, write_column, "WR[MB]");
+  mvwaddstr(window, 1, age_column, "AGE[s]");
+  wattroff(window, COLOR_PAIR(2));
+  ++row;
+  const auto now = std::chrono::steady_clock::now();
+  std::array<char, 32> buffer{};
+  const auto number = [window, &buffer](int row, int column, float value,
+                                        int width) {
+    const std::string_view text{TruncatedNumber(value, width, buffer)};
+    mvwaddnstr(window, row, column, text.data(),
+               static_cast<int>(text.size()));
+  };
+  // The CPU share of a command is relative to all the CPUs, like in the
+  // processes view. The RSS is the highest high-water mark of its processes.
+  for (const ExitedCommand* command :
+       exited_tasks.Busiest(static_cast<std::size_t>(std::max(n, 0)))) {
+    mvwhline(window, ++row, command_column, ' ', getmaxx(window) - 3);
+    mvwaddnstr(window, row, command_column, command->command.c_str(),
+               exits_column - command_column - 1);
+    mvwprintw(window, row, exits_column, "%llu",
+              static_cast<unsigned long long>(command->exits));
+    number(row, cpu_time_column, static_cast<float>(command->cpu_seconds), 7);
+    number(row, cpu_column, command->cpu_utilization * 100, 6);
+    number(row, rss_column, command->peak_rss_kilobytes / 1024.0f, 7);
+    number(row, read_column, command->read_bytes / 1e6f, 7);
+    number(row, write_column, command->write_bytes / 1e6f, 7);
+    mvwprintw(window, row, age_column, "%lld",
+              static_cast<long long>(
+                  std::chrono::duration_cast<std::chrono::seconds>(
+                      now - command->last_exit)
+                      .count()));
+  }
+  const ExitInterval& interval{exited_tasks.LastInterval()};
+  mvwprintw(window, 0, 2, " exited in the last interval: %llu, %.1f%% CPU ",
+            static_cast<unsigned long long>(interval.exits),
+            interval.cpu_utilization * 100);
+  if (exited_tasks.Overruns() > 0) {
+    wprintw(window, "(%llu overruns) ",
+            static_cast<unsigned long long>(exited_tasks.Overruns()));
+  }
+}
+
+void NCursesDisplay::Display(System& system,
+                             std::chrono::steady_clock::time_point start_time) {
+  ScreenReseter reseter{};
+  initscr();             // start ncurses
+  noecho();              // do not print input values
+  cbreak();              // terminate ncurses on ctrl + c
+  keypad(stdscr, TRUE);  // report the navigation keys
+  start_color();         // enable color
+  timeout(0);  // the refresh interval is controlled by the pressure monitor
+
+  WINDOW* system_window = newwin(kSystemWindowHeight, 1, 0, 0);
+  WINDOW* process_window = newwin(kMinProcessHeight, 1, kSystemWindowHeight, 0);
+  FitWindows(system_window, process_window);
+
+  // The 'c', 'd', 'i' and 'x' keys switch between the processes view and the
+  // cgroups, disks, interrupts and exited processes views (the last one
+  // enables the exit accounting), the 'f' key changes which disks are shown,
+  // the 's' key changes the sort order of the current view, the 'n' key shows
+  // the NUMA placement of the processes, the 'm' key shows their PSS/USS
+  // instead of the RSS, the 'o' key shows their number of open sockets and the
+  // 'g' key shows their cgroup.
+  // The arrow, PgUp/PgDn and Home/End keys scroll the processes, and the '/'
+  // key starts a prompt to jump to a PID.
+  View view{View::kProcesses};
+  DiskFilter disk_filter{DiskFilter::kPhysical};
+  bool show_numa{false};
+  bool show_memory_detail{false};
+  bool show_sockets{false};
+  bool show_cgroups{false};
+  CgroupSortKey cgroup_sort_key{CgroupSortKey::kCpu};
+  ProcessSortKey process_sort_key{ProcessSortKey::kUser};
+  ProcessViewport viewport{};
+  // The digits typed in the jump to PID prompt, while it is open.
+  bool pid_prompt_open{false};
+  std::string pid_prompt{};
+
+  // Startup times, measured from the program start: until the system section
+  // is first drawn, until the first process table and until the full process
+  // list. They are zero until the respective event happens.
+  std::chrono::milliseconds first_frame_time{};
+  std::chrono::milliseconds first_table_time{};
+  std::chrono::milliseconds full_list_time{};
+  const auto elapsed_time = [start_time]() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time);
+  };
+
+  while (1) {
+    init_pair(1, COLOR_BLUE, COLOR_BLACK);
+    init_pair(2, COLOR_GREEN, COLOR_BLACK);
+    init_pair(3, COLOR_RED, COLOR_BLACK);
+    // The rows of the processes section, without the borders and the header.
+    const int n{getmaxy(process_window) - 3};
+    viewport.Resize(n);
+    // The work of the tick is reduced while the monitor is over its CPU
+    // budget.
+    BudgetGovernor& governor{system.Governor()};
+    governor.Update(system.TickTime(), system.TickResource());
+    const DegradationLevel level{governor.Level()};
+    ProcessViewOptions view_options{};
+    view_options.show_numa =
+        show_numa && level == DegradationLevel::kNone;
+    view_options.show_scheduler_stats = level == DegradationLevel::kNone;
+    view_options.show_sockets =
+        show_sockets && level == DegradationLevel::kNone;
+    view_options.show_cgroups = show_cgroups;
+    view_options.detailed_rows =
+        level >= DegradationLevel::kFewerDetailedRows ? n / 4 : n;
+    const ProcessSortKey effective_sort_key{
+        level == DegradationLevel::kNone ? process_sort_key
+                                         : ProcessSortKey::kUser};
+
+    werase(process_window);
+    box(system_window, 0, 0);
+    box(process_window, 0, 0);
+    mvwprintw(system_window, 0, 2, " monitor CPU %.1f%% of %.1f%%: %s ",
+              governor.Usage() * 100, governor.Budget() * 100,
+              BudgetGovernor::Describe(level));
+    DisplaySystem(system, system_window);
+    // DisplaySystem already refreshed the system section in the terminal.
+    if (first_frame_time.count() == 0) {
+      first_frame_time = elapsed_time();
+    }
+    // The disks and the interrupts are sampled every tick, like the network,
+    // even while their views are closed, so the rates (and the interrupt
+    // imbalance) shown when a view is opened cover one tick.
+    system.Disks();
+    system.Interrupts();
+    // Number of processes in the list and pending to be added to it.
+    std::size_t listed_processes{0};
+    int pending_processes{0};
+    if (view == View::kCgroups) {
+      DisplayCgroups(system.Cgroups(cgroup_sort_key), process_window, n,
+                     cgroup_sort_key);
+    } else if (view == View::kDisks) {
+      DisplayDisks(system.Disks(), process_window, n, disk_filter);
+    } else if (view == View::kInterrupts) {
+      DisplayInterrupts(system.Interrupts(), process_window, n);
+    } else if (view == View::kExitedTasks) {
+      DisplayExitedTasks(system.ExitedTasks(), process_window, n);
+    } else {
+      std::vector<Process>& processes{system.Processes()};
+      process_columns::AllColumns::Sort(processes, effective_sort_key,
+                                        system.Sample(),
+                                        system.TickResource());
+      listed_processes = processes.size();
+      pending_processes = system.PendingProcesses();
+      viewport.Update(processes);
+      view_options.first_row = viewport.First();
+      view_options.selected_pid = viewport.SelectedPid();
+      if (show_memory_detail) {
+        // The expensive metrics are not refreshed while the monitor is over
+        // its CPU budget, so they are shown as stale.
+        if (level == DegradationLevel::kNone) {
+          system.RefreshExpensiveMetrics(viewport.First(),
+                                         static_cast<std::size_t>(n));
+        }
+        view_options.memory_detail = &system.MetricScheduler();
+      }
+      DisplayProcesses(processes, process_window, n, effective_sort_key,
+                       system.Sample(), view_options, system.TickResource());
+      // The position in the list, or the jump to PID prompt, in the bottom
+      // border.
+      const int bottom{getmaxy(process_window) - 1};
+      if (pid_prompt_open) {
+        mvwprintw(process_window, bottom, 2, " jump to PID: %s_ ",
+                  pid_prompt.c_str());
+      } else if (!processes.empty()) {
+        mvwprintw(process_window, bottom, 2, " %zu-%zu of %zu ",
+                  viewport.First() + 1,
+                  std::min(viewport.First() + n, processes.size()),
+                  processes.size());
+      }
+    }
+    if (view == View::kProcesses) {
+      const std::chrono::milliseconds elapsed{elapsed_time()};
+      if (first_table_time.count() == 0) {
+        first_table_time = elapsed;
+      }
+      if (full_list_time.count() == 0 && pending_processes == 0) {
+        full_list_time = elapsed;
+      }
+    }
+    if (pending_processes > 0) {
+      mvwprintw(process_window, 0, 2, " loading: %zu of %zu processes ",
+                listed_processes, listed_processes + pending_processes);
+    } else if (full_list_time.count() > 0 &&
+               (view == View::kProcesses || view == View::kCgroups)) {
+      mvwprintw(process_window, 0, 2,
+                " first frame %lld ms, first table %lld ms, full list %lld ms ",
+                static_cast<long long>(first_frame_time.count()),
+                static_cast<long long>(first_table_time.count()),
+                static_cast<long long>(full_list_time.count()));
+    }
+    wrefresh(system_window);
+    wrefresh(process_window);
+    refresh();
+    system.EndTick();
+
+    // While the process list is being filled the next frame is drawn right
+    // away. Otherwise, waits for the next refresh, which happens earlier when
+    // there is a stall or a key press. The keys typed meanwhile, and the
+    // terminal resizes, are handled before the next frame.
+    const int slowdown{level == DegradationLevel::kSlowRefresh ? 3 : 1};
+    if (pending_processes == 0) {
+      system.Pressure().Wait(STDIN_FILENO, slowdown);
+    }
+    for (int key{getch()}; key != ERR; key = getch()) {
+      if (pid_prompt_open) {
+        if (key >= '0' && key <= '9' && pid_prompt.size() < kMaxPidDigits) {
+          pid_prompt += static_cast<char>(key);
+        } else if ((key == KEY_BACKSPACE || key == 127 || key == '\b') &&
+                   !pid_prompt.empty()) {
+          pid_prompt.pop_back();
+        } else if (key == '\n' || key == KEY_ENTER) {
+          if (!pid_prompt.empty()) {
+            viewport.SelectPid(std::stoi(pid_prompt));
+          }
+          pid_prompt_open = false;
+        } else if (key == 27) {  // escape
+          pid_prompt_open = false;
+        }
+        continue;
+      }
+      switch (key) {
+        case KEY_RESIZE:
+          FitWindows(system_window, process_window);
+          wclear(system_window);
+          wclear(process_window);
+          break;
+        case KEY_UP:
+          viewport.Move(-1);
+          break;
+        case KEY_DOWN:
+          viewport.Move(1);
+          break;
+        case KEY_PPAGE:
+          viewport.PageUp();
+          break;
+        case KEY_NPAGE:
+          viewport.PageDown();
+          break;
+        case KEY_HOME:
+          viewport.Home();
+          break;
+        case KEY_END:
+          viewport.End();
+          break;
+        case '/':
+          pid_prompt_open = true;
+          pid_prompt.clear();
+          break;
+        case 'c':
+          view = view == View::kCgroups ? View::kProcesses : View::kCgroups;
+          break;
+        case 'd':
+          view = view == View::kDisks ? View::kProcesses : View::kDisks;
+          break;
+        case 'i':
+          view = view == View::kInterrupts ? View::kProcesses
+                                           : View::kInterrupts;
+          break;
+        case 'x':
+          view = view == View::kExitedTasks ? View::kProcesses
+                                            : View::kExitedTasks;
+          if (view == View::kExitedTasks) {
+            system.EnableExitAccounting();
+          }
+          break;
+        case 'f':
+          disk_filter = static_cast<DiskFilter>(
+              (static_cast<int>(disk_filter) + 1) %
+              (static_cast<int>(DiskFilter::kAll) + 1));
+          break;
+        case 'n':
+          show_numa = !show_numa;
+          break;
+        case 'm':
+          show_memory_detail = !show_memory_detail;
+          break;
+        case 'o':
+          show_sockets = !show_sockets;
+          break;
+        case 'g':
+          show_cgroups = !show_cgroups;
+          break;
+        case 's':
+          if (view == View::kCgroups) {
+            cgroup_sort_key = static_cast<CgroupSortKey>(
+                (static_cast<int>(cgroup_sort_key) + 1) %
+                (static_cast<int>(CgroupSortKey::kName) + 1));
+          } else {
+            process_sort_key = static_cast<ProcessSortKey>(
+                (static_cast<int>(process_sort_key) + 1) %
+                (static_cast<int>(ProcessSortKey::kContextSwitches) + 1));
+          }
+          break;
+        default:
+          break;
+      }
+    }
+  }
+  endwin();
+}
+
+void NCursesDisplay::DisplaySnapshot(const snapshot::SnapshotView& view,
+                                     WINDOW* system_window,
+                                     WINDOW* process_window, int n) {
+  // The snapshot strings may be torn if the publisher overwrites the slot
+  // while we read it, so they are printed with bounded lengths.
+  const snapshot::SystemRecord& system{view.System()};
+  std::pmr::monotonic_buffer_resource resource{};
+  int row{0};
+  const std::string_view operating_system{
+      snapshot::FieldView(system.operating_system)};
+  const std::string_view kernel{snapshot::FieldView(system.kernel)};
+  mvwprintw(system_window, ++row, 2, "OS: %.*s",
+            static_cast<int>(operating_system.size()),
+            operating_system.data());
+  mvwprintw(system_window, ++row, 2, "Kernel: %.*s",
+            static_cast<int>(kernel.size()), kernel.data());
+  mvwprintw(system_window, ++row, 2, "CPU: ");
+  wattron(system_window, COLOR_PAIR(1));
+  mvwaddstr(system_window, row, 10,
+            ProgressBar(system.cpu_utilization, &resource).c_str());
+  wattroff(system_window, COLOR_PAIR(1));
+  mvwprintw(system_window, ++row, 2, "Memory: ");
+  wattron(system_window, COLOR_PAIR(1));
+  mvwaddstr(system_window, row, 10,
+            ProgressBar(system.memory_utilization, &resource).c_str());
+  wattroff(system_window, COLOR_PAIR(1));
+  mvwprintw(system_window, ++row, 2, "Total Processes: %d",
+            system.total_processes);
+  mvwprintw(system_window, ++row, 2, "Running Processes: %d",
+            system.running_processes);
+  mvwprintw(system_window, ++row, 2, "Up Time: %s",
+            Format::ElapsedTime(system.uptime_seconds).c_str());
+
+  row = 0;
   int const pid_column{2};
   int const user_column{9};
   int const cpu_column{20};
   int const ram_column{30};
   int const time_column{39};
   int const command_column{50};
-  wattron(window, COLOR_PAIR(2));
-  mvwprintw(window, ++row, pid_column, "PID");
-  mvwprintw(window, row, user_column, "USER");
-  mvwprintw(window, row, cpu_column, "CPU[%%]");
-  mvwprintw(window, row, ram_column, "RAM[MB]");
-  mvwprintw(window, row, time_column, "TIME+");
-  mvwprintw(window, row, command_column, "COMMAND");
-  wattroff(window, COLOR_PAIR(2));
-  for (int i = 0; i < n; ++i) {
-    // You need to take care of the fact that the cpu utilization has already
-    // been multiplied by 100.
-    // Clear the line
-    mvwprintw(window, ++row, pid_column,
-              (string(window->_maxx - 2, ' ').c_str()));
-
-    mvwprintw(window, row, pid_column, to_string(processes[i].Pid()).c_str());
-    mvwprintw(window, row, user_column, processes[i].User().c_str());
-    float cpu = processes[i].CpuUtilization() * 100;
-    mvwprintw(window, row, cpu_column, to_string(cpu).substr(0, 4).c_str());
-    mvwprintw(window, row, ram_column, processes[i].Ram().c_str());
-    mvwprintw(window, row, time_column,
-              Format::ElapsedTime(processes[i].UpTime()).c_str());
-    mvwprintw(window, row, command_column,
-              processes[i].Command().substr(0, window->_maxx - 50).c_str());
+  wattron(process_window, COLOR_PAIR(2));
+  mvwprintw(process_window, ++row, pid_column, "PID");
+  mvwprintw(process_window, row, user_column, "USER");
+  mvwprintw(process_window, row, cpu_column, "CPU[%%]");
+  mvwprintw(process_window, row, ram_column, "RAM[MB]");
+  mvwprintw(process_window, row, time_column, "TIME+");
+  mvwprintw(process_window, row, command_column, "COMMAND");
+  wattroff(process_window, COLOR_PAIR(2));
+  const int rows{std::min(n, static_cast<int>(view.ProcessCount()))};
+  std::array<char, 32> buffer{};
+  for (int i = 0; i < rows; ++i) {
+    const snapshot::ProcessRecord& process{view.Processes()[i]};
+    mvwhline(process_window, ++row, pid_column, ' ',
+             getmaxx(process_window) - 3);
+    mvwprintw(process_window, row, pid_column, "%d", process.pid);
+    const std::string_view user{snapshot::FieldView(process.user)};
+    mvwaddnstr(process_window, row, user_column, user.data(),
+               static_cast<int>(user.size()));
+    const std::string_view cpu_text{
+        TruncatedNumber(process.cpu_utilization * 100, 4, buffer)};
+    mvwaddnstr(process_window, row, cpu_column, cpu_text.data(),
+               static_cast<int>(cpu_text.size()));
+    if (process.ram_kb < 0) {
+      mvwaddstr(process_window, row, ram_column, "-");
+    } else {
+      mvwprintw(process_window, row, ram_column, "%ld MB",
+                static_cast<long>(process.ram_kb / 1024));
+    }
+    mvwaddstr(process_window, row, time_column,
+              Format::ElapsedTime(process.uptime_seconds).c_str());
+    const std::string_view command{snapshot::FieldView(process.command)};
+    mvwaddnstr(process_window, row, command_column, command.data(),
+               std::min(static_cast<int>(command.size()),
+                        std::max(getmaxx(process_window) - 51, 0)));
   }
 }
 
-void NCursesDisplay::Display(System& system, int n) {
+void NCursesDisplay::Display(SnapshotReader& reader, int n) {
   ScreenReseter reseter{};
   initscr();      // start ncurses
   noecho();       // do not print input values
   cbreak();       // terminate ncurses on ctrl + c
   start_color();  // enable color
+  timeout(1000);  // wait for a key press up to the refresh interval
 
   int x_max{getmaxx(stdscr)};
   WINDOW* system_window = newwin(9, x_max - 1, 0, 0);
@@ -112,14 +931,26 @@ void NCursesDisplay::Display(System& system, int n) {
   while (1) {
     init_pair(1, COLOR_BLUE, COLOR_BLACK);
     init_pair(2, COLOR_GREEN, COLOR_BLACK);
+    // If the publisher keeps overwriting the slot while we draw it, we keep
+    // the last frame and try again in the next refresh.
+    reader.Refresh();
+    reader.Read([=](const snapshot::SnapshotView& view) {
+      werase(system_window);
+      werase(process_window);
+      box(system_window, 0, 0);
+      box(process_window, 0, 0);
+      DisplaySnapshot(view, system_window, process_window, n);
+    });
+    // The last frame is kept when the publisher stops, but marked as old.
     box(system_window, 0, 0);
-    box(process_window, 0, 0);
-    DisplaySystem(system, system_window);
-    DisplayProcesses(system.Processes(), process_window, n);
+    if (reader.Stale()) {
+      wattron(system_window, A_REVERSE);
+      mvwaddstr(system_window, 0, 2, " STALE: the publisher is not running ");
+      wattroff(system_window, A_REVERSE);
+    }
     wrefresh(system_window);
     wrefresh(process_window);
     refresh();
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+    getch();
   }
-  endwin();
 }
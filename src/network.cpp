@@ -0,0 +1,230 @@
+#include "network.h"
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parser_helper.h"
+
+namespace {
+
+// Calculate the rate of a counter, which is zero if the counter was reset.
+float Rate(long long current, long long previous, double elapsed_seconds) {
+  if (elapsed_seconds <= 0 || current < previous) {
+    return 0;
+  }
+  return static_cast<float>((current - previous) / elapsed_seconds);
+}
+
+// Find the value of a field in the "/proc/net/snmp" file, which has two lines
+// per protocol: the first with the field names and the second with the values,
+// both starting with the protocol name (e.g. "Tcp:").
+long long FindSnmpValue(std::string_view names, std::string_view values,
+                        std::string_view field) {
+  parser_helper::FieldTokenizer name_tokenizer{names};
+  parser_helper::FieldTokenizer value_tokenizer{values};
+  for (std::string_view name{name_tokenizer.Next()}; !name.empty();
+       name = name_tokenizer.Next()) {
+    const std::string_view value{value_tokenizer.Next()};
+    if (name == field) {
+      return parser_helper::FieldTokenizer{value}.NextNumber<long long>();
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+
+void NetworkMonitor::Update(const std::chrono::steady_clock::time_point now,
+                            std::pmr::memory_resource* resource) {
+  if (now == last_update_) {
+    return;
+  }
+  // In the first update we consider the time since the boot.
+  const bool first_update{last_update_ ==
+                          std::chrono::steady_clock::time_point{}};
+  double elapsed_seconds{
+      std::chrono::duration<double>(now - last_update_).count()};
+  if (first_update) {
+    timespec boot_time{};
+    clock_gettime(CLOCK_BOOTTIME, &boot_time);
+    elapsed_seconds = boot_time.tv_sec + boot_time.tv_nsec / 1e9;
+  }
+  last_update_ = now;
+  UpdateInterfaces(elapsed_seconds, first_update, resource);
+  UpdateTcp(elapsed_seconds, resource);
+}
+
+const std::vector<InterfaceStats>& NetworkMonitor::Interfaces() const {
+  return interfaces_;
+}
+
+const TcpStats& NetworkMonitor::Tcp() const { return tcp_; }
+
+void NetworkMonitor::UpdateInterfaces(const double elapsed_seconds,
+                                      const bool first_update,
+                                      std::pmr::memory_resource* resource) {
+  std::pmr::string content{resource};
+  if (!parser_helper::TryReadFile("/proc/net/dev", content)) {
+    interfaces_.clear();
+    return;
+  }
+  // After two header lines, each line has the format:
+  //   <name>: <receive bytes> <packets> <errs> <drop> <fifo> <frame>
+  //   <compressed> <multicast> <transmit bytes> <packets> <errs> <drop> ...
+  // The interfaces that disappeared are removed, and the list is kept in the
+  // file order.
+  std::size_t count{0};
+  parser_helper::ForEachLine(content, [&](std::string_view line) {
+    const std::size_t separator{line.find(':')};
+    if (separator == std::string_view::npos) {
+      return;  // a header line
+    }
+    std::string_view name{line.substr(0, separator)};
+    name.remove_prefix(std::min(name.find_first_not_of(' '), name.size()));
+    // The interfaces are usually in the same order in every update, so the
+    // search is cheap.
+    auto found = std::find_if(
+        interfaces_.begin() + count, interfaces_.end(),
+        [name](const InterfaceStats& stats) { return stats.name == name; });
+    const bool new_interface{found == interfaces_.end()};
+    if (new_interface) {
+      InterfaceStats stats{};
+      stats.name = std::string{name};
+      found = interfaces_.insert(interfaces_.begin() + count, stats);
+    } else if (found != interfaces_.begin() + count) {
+      std::rotate(interfaces_.begin() + count, found, found + 1);
+      found = interfaces_.begin() + count;
+    }
+    ++count;
+
+    InterfaceStats& stats{*found};
+    parser_helper::FieldTokenizer tokenizer{line.substr(separator + 1)};
+    const long long receive_bytes{tokenizer.NextNumber<long long>()};
+    const long long receive_packets{tokenizer.NextNumber<long long>()};
+    const long long receive_errors{tokenizer.NextNumber<long long>()};
+    const long long receive_drops{tokenizer.NextNumber<long long>()};
+    tokenizer.Skip(4);  // fifo frame compressed multicast
+    const long long transmit_bytes{tokenizer.NextNumber<long long>()};
+    const long long transmit_packets{tokenizer.NextNumber<long long>()};
+    const long long transmit_errors{tokenizer.NextNumber<long long>()};
+    const long long transmit_drops{tokenizer.NextNumber<long long>()};
+
+    // An interface found after the first update (e.g. the veth of a new
+    // container) has no rates in its first update, since its counters were
+    // not accumulated in the interval. A zero interval gives zero rates.
+    const double interval_seconds{new_interface && !first_update
+                                      ? 0.0
+                                      : elapsed_seconds};
+    stats.receive_bytes_per_second =
+        Rate(receive_bytes, stats.receive_bytes, interval_seconds);
+    stats.receive_packets_per_second =
+        Rate(receive_packets, stats.receive_packets, interval_seconds);
+    stats.transmit_bytes_per_second =
+        Rate(transmit_bytes, stats.transmit_bytes, interval_seconds);
+    stats.transmit_packets_per_second =
+        Rate(transmit_packets, stats.transmit_packets, interval_seconds);
+    stats.errors_per_second =
+        Rate(receive_errors + transmit_errors,
+             stats.receive_errors + stats.transmit_errors, interval_seconds);
+    stats.drops_per_second =
+        Rate(receive_drops + transmit_drops,
+             stats.receive_drops + stats.transmit_drops, interval_seconds);
+    stats.receive_bytes = receive_bytes;
+    stats.receive_packets = receive_packets;
+    stats.receive_errors = receive_errors;
+    stats.receive_drops = receive_drops;
+    stats.transmit_bytes = transmit_bytes;
+    stats.transmit_packets = transmit_packets;
+    stats.transmit_errors = transmit_errors;
+    stats.transmit_drops = transmit_drops;
+  });
+  interfaces_.resize(count);
+}
+
+void NetworkMonitor::UpdateTcp(const double elapsed_seconds,
+                               std::pmr::memory_resource* resource) {
+  std::pmr::string content{resource};
+  if (!parser_helper::TryReadFile("/proc/net/snmp", content)) {
+    tcp_ = TcpStats{};
+    return;
+  }
+  std::string_view names{};
+  std::string_view values{};
+  parser_helper::ForEachLine(content, [&](std::string_view line) {
+    if (line.substr(0, 4) == "Tcp:") {
+      (names.empty() ? names : values) = line;
+    }
+  });
+  const long long active_opens{FindSnmpValue(names, values, "ActiveOpens")};
+  const long long passive_opens{FindSnmpValue(names, values, "PassiveOpens")};
+  const long long retransmitted_segments{
+      FindSnmpValue(names, values, "RetransSegs")};
+  tcp_.available = !values.empty();
+  tcp_.established = FindSnmpValue(names, values, "CurrEstab");
+  tcp_.active_opens_per_second =
+      Rate(active_opens, tcp_.active_opens, elapsed_seconds);
+  tcp_.passive_opens_per_second =
+      Rate(passive_opens, tcp_.passive_opens, elapsed_seconds);
+  tcp_.retransmitted_segments_per_second =
+      Rate(retransmitted_segments, tcp_.retransmitted_segments,
+           elapsed_seconds);
+  tcp_.active_opens = active_opens;
+  tcp_.passive_opens = passive_opens;
+  tcp_.retransmitted_segments = retransmitted_segments;
+
+  // The line "TCP: inuse <n> orphan <n> tw <n> alloc <n> mem <n>" has the
+  // number of sockets in some states.
+  if (!parser_helper::TryReadFile("/proc/net/sockstat", content)) {
+    return;
+  }
+  parser_helper::FieldTokenizer tokenizer{
+      parser_helper::FindValue(content, "TCP:")};
+  for (std::string_view key{tokenizer.Next()}; !key.empty();
+       key = tokenizer.Next()) {
+    const long long value{tokenizer.NextNumber<long long>()};
+    if (key == "inuse") {
+      tcp_.in_use = value;
+    } else if (key == "orphan") {
+      tcp_.orphan = value;
+    } else if (key == "tw") {
+      tcp_.time_wait = value;
+    }
+  }
+}
+
+int CountProcessSockets(const int pid) {
+  std::array<char, 32> path{};
+  std::snprintf(path.data(), path.size(), "/proc/%d/fd", pid);
+  DIR* directory{opendir(path.data())};
+  if (directory == nullptr) {
+    return -1;
+  }
+  // The links of the sockets point to "socket:[<inode>]".
+  const std::string_view kSocketPrefix{"socket:"};
+  std::array<char, 16> target{};
+  int sockets{0};
+  while (const dirent* entry{readdir(directory)}) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+    const ssize_t size{readlinkat(dirfd(directory), entry->d_name,
+                                  target.data(), target.size())};
+    if (size >= static_cast<ssize_t>(kSocketPrefix.size()) &&
+        std::string_view{target.data(), kSocketPrefix.size()} ==
+            kSocketPrefix) {
+      ++sockets;
+    }
+  }
+  closedir(directory);
+  return sockets;
+}
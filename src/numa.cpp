@@ -0,0 +1,160 @@
+#include "numa.h"
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parser_helper.h"
+
+namespace {
+
+const char* kNodesDirectory{"/sys/devices/system/node"};
+
+// Build the path of a file in a node directory.
+std::pmr::string NodeFilePath(int node, std::string_view file_name,
+                              std::pmr::memory_resource* resource) {
+  std::pmr::string path{kNodesDirectory, resource};
+  path += "/node";
+  path += std::to_string(node);
+  path += '/';
+  path += file_name;
+  return path;
+}
+
+}  // namespace
+
+NumaMonitor::NumaMonitor() {
+  // The nodes are the directories named "node<N>".
+  DIR* directory{opendir(kNodesDirectory)};
+  if (directory == nullptr) {
+    return;
+  }
+  while (const dirent* entry{readdir(directory)}) {
+    const std::string_view name{entry->d_name};
+    if (name.substr(0, 4) != "node") {
+      continue;
+    }
+    int node{};
+    const auto [end, error] =
+        std::from_chars(name.data() + 4, name.data() + name.size(), node);
+    if (error == std::errc{} && end == name.data() + name.size()) {
+      NumaNodeStats stats{};
+      stats.node = node;
+      nodes_.push_back(stats);
+    }
+  }
+  closedir(directory);
+  std::sort(nodes_.begin(), nodes_.end(),
+            [](const NumaNodeStats& a, const NumaNodeStats& b) {
+              return a.node < b.node;
+            });
+}
+
+const std::vector<NumaNodeStats>& NumaMonitor::Update(
+    const std::chrono::steady_clock::time_point now,
+    std::pmr::memory_resource* resource) {
+  if (now == last_update_) {
+    return nodes_;
+  }
+  last_update_ = now;
+  std::pmr::string content{resource};
+  for (NumaNodeStats& stats : nodes_) {
+    // The lines have the format "Node <N> <key>: <value> kB".
+    if (parser_helper::TryReadFile(
+            NodeFilePath(stats.node, "meminfo", resource).c_str(), content)) {
+      parser_helper::ForEachLine(content, [&stats](std::string_view line) {
+        parser_helper::FieldTokenizer tokenizer{line};
+        tokenizer.Skip(2);
+        const std::string_view key{tokenizer.Next()};
+        if (key == "MemTotal:") {
+          stats.total_kb = tokenizer.NextNumber<long long>();
+        } else if (key == "MemFree:") {
+          stats.free_kb = tokenizer.NextNumber<long long>();
+        }
+      });
+    }
+    // The lines have the format "<key> <value>", where the values are
+    // cumulative page counts.
+    if (parser_helper::TryReadFile(
+            NodeFilePath(stats.node, "numastat", resource).c_str(), content)) {
+      long long local_allocations{stats.local_allocations};
+      long long remote_allocations{stats.remote_allocations};
+      parser_helper::ForEachLine(content, [&](std::string_view line) {
+        parser_helper::FieldTokenizer tokenizer{line};
+        const std::string_view key{tokenizer.Next()};
+        if (key == "local_node") {
+          local_allocations = tokenizer.NextNumber<long long>();
+        } else if (key == "other_node") {
+          remote_allocations = tokenizer.NextNumber<long long>();
+        }
+      });
+      const long long local_delta{local_allocations - stats.local_allocations};
+      const long long remote_delta{remote_allocations -
+                                   stats.remote_allocations};
+      stats.remote_allocation_ratio =
+          local_delta + remote_delta > 0
+              ? remote_delta * 1.0f / (local_delta + remote_delta)
+              : 0;
+      stats.local_allocations = local_allocations;
+      stats.remote_allocations = remote_allocations;
+    }
+  }
+  return nodes_;
+}
+
+int NumaMonitor::NodeCount() const { return static_cast<int>(nodes_.size()); }
+
+bool ReadNumaPlacement(const int pid,
+                       std::vector<long long>& kilobytes_per_node,
+                       std::pmr::memory_resource* resource) {
+  std::pmr::string content{resource};
+  if (!parser_helper::TryReadFile(
+          parser_helper::ProcessFilePath(pid, "numa_maps", resource).c_str(),
+          content)) {
+    return false;
+  }
+  std::fill(kilobytes_per_node.begin(), kilobytes_per_node.end(), 0);
+  // Each line describes a memory mapping, with the number of pages in each
+  // node as "N<node>=<pages>" fields and the page size as
+  // "kernelpagesize_kB=<size>".
+  const std::size_t kMaxNodes{1024};
+  const std::string_view kPageSizeKey{"kernelpagesize_kB="};
+  parser_helper::ForEachLine(content, [&](std::string_view line) {
+    const std::size_t page_size_pos{line.find(kPageSizeKey)};
+    if (page_size_pos == std::string_view::npos) {
+      return;
+    }
+    const long long page_kb{
+        parser_helper::FieldTokenizer{
+            line.substr(page_size_pos + kPageSizeKey.size())}
+            .NextNumber<long long>()};
+    parser_helper::FieldTokenizer tokenizer{line};
+    for (std::string_view field{tokenizer.Next()}; !field.empty();
+         field = tokenizer.Next()) {
+      const std::size_t separator{field.find('=')};
+      if (field[0] != 'N' || separator == std::string_view::npos) {
+        continue;
+      }
+      std::size_t node{};
+      const auto [end, error] =
+          std::from_chars(field.data() + 1, field.data() + separator, node);
+      if (error != std::errc{} || end != field.data() + separator ||
+          node >= kMaxNodes) {
+        continue;
+      }
+      if (node >= kilobytes_per_node.size()) {
+        kilobytes_per_node.resize(node + 1);
+      }
+      kilobytes_per_node[node] +=
+          page_kb * parser_helper::FieldTokenizer{field.substr(separator + 1)}
+                        .NextNumber<long long>();
+    }
+  });
+  return true;
+}
@@ -1,6 +1,10 @@
 #include "parser_helper.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <algorithm>
+#include <cerrno>
 #include <fstream>
 #include <iterator>
 #include <stdexcept>
@@ -31,9 +35,111 @@ std::unordered_map<std::string, std::string> ExtractKeyValuePairsFromFile(
   return map;
 }
 
+KeyValueMap ExtractKeyValuePairsFromFile(const char* file_path,
+                                         std::string_view separator,
+                                         std::pmr::memory_resource* resource) {
+  const std::pmr::string content{ReadFile(file_path, resource)};
+  KeyValueMap map{resource};
+  std::string_view remaining{content};
+  while (!remaining.empty()) {
+    const std::size_t line_end{remaining.find('\n')};
+    const std::string_view line{remaining.substr(0, line_end)};
+    remaining.remove_prefix(
+        line_end == std::string_view::npos ? remaining.size() : line_end + 1);
+    const std::size_t separator_pos{line.find(separator)};
+    if (separator_pos == std::string_view::npos) {
+      throw UnexpectedFormatError{std::format(
+          "Could not find the separator '{}' in the line '{}' of file {}.",
+          separator, line, file_path)};
+    }
+    map.insert_or_assign(
+        std::pmr::string{line.substr(0, separator_pos), resource},
+        std::pmr::string{line.substr(separator_pos + separator.size()),
+                         resource});
+  }
+  return map;
+}
+
 void RemoveDelimiters(std::string& value) {
   value.erase(std::remove(value.begin(), value.end(), '"'), value.end());
   value.erase(std::remove(value.begin(), value.end(), '\''), value.end());
 }
 
+bool TryReadFile(const char* file_path, std::pmr::string& content) {
+  const int fd{open(file_path, O_RDONLY | O_CLOEXEC)};
+  if (fd < 0) {
+    return false;
+  }
+  const std::size_t kChunkSize{4096};
+  content.clear();
+  std::size_t size{0};
+  while (true) {
+    content.resize(size + kChunkSize);
+    const ssize_t bytes_read{read(fd, content.data() + size, kChunkSize)};
+    if (bytes_read < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytes_read <= 0) {
+      break;
+    }
+    size += static_cast<std::size_t>(bytes_read);
+  }
+  content.resize(size);
+  close(fd);
+  return true;
+}
+
+std::pmr::string ReadFile(const char* file_path,
+                          std::pmr::memory_resource* resource) {
+  std::pmr::string content{resource};
+  if (!TryReadFile(file_path, content)) {
+    throw OpenFileError{file_path};
+  }
+  return content;
+}
+
+std::pmr::string ProcessFilePath(const int pid, std::string_view file_name,
+                                 std::pmr::memory_resource* resource) {
+  std::pmr::string path{resource};
+  path.reserve(16 + file_name.size());
+  fmt::format_to(std::back_inserter(path), "/proc/{}/{}", pid, file_name);
+  return path;
+}
+
+std::string_view FieldTokenizer::Next() {
+  const std::size_t begin{text_.find_first_not_of(" \t\n")};
+  if (begin == std::string_view::npos) {
+    text_ = {};
+    return {};
+  }
+  text_.remove_prefix(begin);
+  const std::size_t end{std::min(text_.find_first_of(" \t\n"), text_.size())};
+  const std::string_view field{text_.substr(0, end)};
+  text_.remove_prefix(end);
+  return field;
+}
+
+void FieldTokenizer::Skip(const int count) {
+  for (int i = 0; i < count; ++i) {
+    Next();
+  }
+}
+
+std::string_view FindValue(std::string_view content, std::string_view key) {
+  std::size_t pos{0};
+  while (pos < content.size()) {
+    const std::size_t line_end{
+        std::min(content.find('\n', pos), content.size())};
+    const std::string_view line{content.substr(pos, line_end - pos)};
+    if (line.substr(0, key.size()) == key) {
+      std::string_view value{line.substr(key.size())};
+      value.remove_prefix(
+          std::min(value.find_first_not_of(" \t"), value.size()));
+      return value;
+    }
+    pos = line_end + 1;
+  }
+  return {};
+}
+
 }  // namespace parser_helper
@@ -0,0 +1,198 @@
+#include "pressure.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+#include "format.h"
+#include "parser_helper.h"
+
+using std::chrono::duration_cast;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace {
+
+// The refresh intervals out of and during a fast capture.
+const milliseconds kNormalInterval{1000};
+const milliseconds kFastInterval{250};
+
+const char* PressureFilePath(const PressureResource pressure_resource) {
+  switch (pressure_resource) {
+    case PressureResource::kCpu:
+      return "/proc/pressure/cpu";
+    case PressureResource::kMemory:
+      return "/proc/pressure/memory";
+    case PressureResource::kIo:
+      return "/proc/pressure/io";
+  }
+  return "";
+}
+
+// Parse the "key=value" fields of one line of a PSI file.
+void ParsePressureLine(std::string_view line, float& avg10, float& avg60,
+                       float& avg300, long long& total) {
+  parser_helper::FieldTokenizer tokenizer{line};
+  tokenizer.Skip(1);  // "some" or "full"
+  for (std::string_view field{tokenizer.Next()}; !field.empty();
+       field = tokenizer.Next()) {
+    const std::size_t separator_pos{field.find('=')};
+    if (separator_pos == std::string_view::npos) {
+      continue;
+    }
+    const std::string_view key{field.substr(0, separator_pos)};
+    if (key == "total") {
+      total = parser_helper::FieldTokenizer{field.substr(separator_pos + 1)}
+                  .NextNumber<long long>();
+      continue;
+    }
+    // The averages are the only floating point values, and from_chars for
+    // floats is not available in all the supported compilers, so we copy the
+    // value to a null terminated buffer to use strtof.
+    std::array<char, 32> value{};
+    field.substr(separator_pos + 1).copy(value.data(), value.size() - 1);
+    if (key == "avg10") {
+      avg10 = std::strtof(value.data(), nullptr);
+    } else if (key == "avg60") {
+      avg60 = std::strtof(value.data(), nullptr);
+    } else if (key == "avg300") {
+      avg300 = std::strtof(value.data(), nullptr);
+    }
+  }
+}
+
+// Register a PSI trigger. The kernel notifies the returned file descriptor
+// with POLLPRI when the tasks are stalled for more than the threshold in the
+// time window. It returns -1 if triggers are not supported or allowed.
+int RegisterTrigger(const char* file_path,
+                    const std::chrono::microseconds threshold,
+                    const std::chrono::microseconds window) {
+  const int fd{open(file_path, O_RDWR | O_NONBLOCK | O_CLOEXEC)};
+  if (fd < 0) {
+    return -1;
+  }
+  const std::string trigger{
+      std::format("some {} {}", threshold.count(), window.count())};
+  // The trigger string must be written with the null terminator.
+  if (write(fd, trigger.c_str(), trigger.size() + 1) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+}  // namespace
+
+PressureStats ParsePressure(std::string_view content) {
+  PressureStats stats{};
+  while (!content.empty()) {
+    const std::size_t line_end{std::min(content.find('\n'), content.size())};
+    const std::string_view line{content.substr(0, line_end)};
+    content.remove_prefix(std::min(line_end + 1, content.size()));
+    if (line.substr(0, 4) == "some") {
+      stats.available = true;
+      ParsePressureLine(line, stats.some_avg10, stats.some_avg60,
+                        stats.some_avg300, stats.some_total_us);
+    } else if (line.substr(0, 4) == "full") {
+      ParsePressureLine(line, stats.full_avg10, stats.full_avg60,
+                        stats.full_avg300, stats.full_total_us);
+    }
+  }
+  return stats;
+}
+
+PressureMonitor::PressureMonitor(
+    const std::chrono::microseconds stall_threshold,
+    const std::chrono::microseconds trigger_window,
+    const milliseconds capture_duration)
+    : trigger_fds_{RegisterTrigger(PressureFilePath(PressureResource::kMemory),
+                                   stall_threshold, trigger_window),
+                   RegisterTrigger(PressureFilePath(PressureResource::kIo),
+                                   stall_threshold, trigger_window)},
+      capture_duration_{capture_duration} {}
+
+PressureMonitor::~PressureMonitor() {
+  for (const int fd : trigger_fds_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
+PressureStats PressureMonitor::Read(
+    const PressureResource pressure_resource,
+    std::pmr::memory_resource* resource) const {
+  std::pmr::string content{resource};
+  if (!parser_helper::TryReadFile(PressureFilePath(pressure_resource),
+                                  content)) {
+    // PSI is only available from Linux 4.20 and when it is enabled in the
+    // kernel.
+    return PressureStats{};
+  }
+  return ParsePressure(content);
+}
+
+bool PressureMonitor::HasTriggers() const {
+  return trigger_fds_[0] >= 0 || trigger_fds_[1] >= 0;
+}
+
+bool PressureMonitor::FastCaptureActive() const {
+  return steady_clock::now() < fast_capture_until_;
+}
+
+milliseconds PressureMonitor::RefreshInterval() const {
+  return FastCaptureActive() ? kFastInterval : kNormalInterval;
+}
+
+PressureMonitor::WaitResult PressureMonitor::Wait(const int input_fd,
+                                                  const int slowdown) {
+  const steady_clock::time_point deadline{steady_clock::now() +
+                                          RefreshInterval() * slowdown};
+  WaitResult result{};
+  while (true) {
+    const auto remaining =
+        duration_cast<milliseconds>(deadline - steady_clock::now());
+    if (remaining.count() <= 0) {
+      return result;
+    }
+    // A negative file descriptor is ignored by poll().
+    pollfd fds[3]{{input_fd, POLLIN, 0},
+                  {trigger_fds_[0], POLLPRI, 0},
+                  {trigger_fds_[1], POLLPRI, 0}};
+    const int ready{poll(fds, 3, static_cast<int>(remaining.count()))};
+    if (ready < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ready <= 0) {
+      return result;
+    }
+    for (int i = 1; i < 3; ++i) {
+      if (fds[i].revents & (POLLERR | POLLNVAL)) {
+        // The trigger is not valid anymore, so we stop watching it.
+        close(trigger_fds_[i - 1]);
+        trigger_fds_[i - 1] = -1;
+      }
+    }
+    if (fds[1].revents & POLLPRI || fds[2].revents & POLLPRI) {
+      result.stalled = true;
+      fast_capture_until_ = steady_clock::now() + capture_duration_;
+    }
+    if (fds[0].revents != 0) {
+      result.input_ready = true;
+      return result;
+    }
+    if (result.stalled) {
+      // The next refresh happens at the fast rate.
+      return result;
+    }
+  }
+}
@@ -6,20 +6,23 @@
 #include <experimental/optional>
 #include <fstream>
 #include <iostream>
+#include <memory_resource>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <vector>
 
 #include "errors.h"
 #include "format.h"
+#include "network.h"
+#include "numa.h"
 #include "parser_helper.h"
 
 using std::string;
 using std::to_string;
 using std::vector;
 using std::chrono::duration_cast;
-using std::chrono::milliseconds;
 using std::chrono::seconds;
 using std::chrono::system_clock;
 
@@ -30,6 +33,20 @@ struct UserInfo {
   std::string name{};
 };
 
+// Get the fields of the "/proc/<pid>/stat" file that come after the command
+// name.
+//
+// The command name is the second field and it is enclosed in parenthesis, but
+// it can contain spaces and parenthesis itself, so we look for the last ')' in
+// the content. The first returned field is the 3rd property (the state).
+std::string_view StatFieldsAfterCommand(std::string_view content) {
+  const std::size_t command_end{content.rfind(')')};
+  if (command_end == std::string_view::npos) {
+    return {};
+  }
+  return content.substr(command_end + 1);
+}
+
 // Return the start time of the process.
 //
 // In Linux systems we can find the time a process started after the system
@@ -37,30 +54,23 @@ struct UserInfo {
 // We use this value combined with the system boot time to discover the process
 // start time.
 system_clock::time_point CalculateProcessStartTime(
-    const int pid, const system_clock::time_point system_boot_time) {
-  const char* kStatFilePathMask{"/proc/{}/stat"};
-  std::string file_path{std::format(kStatFilePathMask, pid)};
-  std::ifstream stat_file{file_path};
-  if (!stat_file) {
+    const int pid, const system_clock::time_point system_boot_time,
+    std::pmr::memory_resource* resource) {
+  std::pmr::string content{resource};
+  if (!parser_helper::TryReadFile(
+          parser_helper::ProcessFilePath(pid, "stat", resource).c_str(),
+          content)) {
     // The process related files can be deleted between the time we discover its
     // pid and we try to get information about it. In this case the process will
     // be removed in the next iteration. So we just return a dummy value here.
     return system_boot_time;
   }
-  std::string line{};
-  if (!std::getline(stat_file, line)) {
-    // It is the same case of the file not existing. Se the previous comment.
-    return system_boot_time;
-  }
-  std::istringstream line_parser{line};
-  // ignore the first 21 words
-  for (int i = 0; i < 21; i++) {
-    line_parser.ignore(std::numeric_limits<std::streamsize>::max(), ' ');
-  }
+  parser_helper::FieldTokenizer tokenizer{StatFieldsAfterCommand(content)};
+  // ignore the properties 3 to 21
+  tokenizer.Skip(19);
 
   // this is the process start time after the boot time
-  long long start_time{};
-  line_parser >> start_time;
+  long long start_time{tokenizer.NextNumber<long long>()};
   start_time /= sysconf(_SC_CLK_TCK);  // since it is expressed in clock ticks,
                                        // we need to convert to seconds
   return system_boot_time + seconds{start_time};
@@ -69,181 +79,381 @@ system_clock::time_point CalculateProcessStartTime(
 // Fetch the command line used to launch the process.
 //
 // In Linux systems the command used to launch the process is stored in the
-// "/proc/<pid>/cmdline" file.
-std::string FetchCommandLine(const int pid) {
-  const char* kCommandLineFilePathMask{"/proc/{}/cmdline"};
-  std::string file_path{std::format(kCommandLineFilePathMask, pid)};
-
-  std::ifstream cmd_file{file_path};
-  if (!cmd_file) {
+// "/proc/<pid>/cmdline" file. The arguments are separated by null characters.
+std::string FetchCommandLine(const int pid,
+                             std::pmr::memory_resource* resource) {
+  std::pmr::string content{resource};
+  if (!parser_helper::TryReadFile(
+          parser_helper::ProcessFilePath(pid, "cmdline", resource).c_str(),
+          content) ||
+      content.empty()) {
     // The process related files can be deleted between the time we discover its
     // pid and we try to get information about it. In this case the process will
     // be removed in the next iteration. So we just return a dummy value here.
     return "-";
   }
-  std::string line{};
-  if (!std::getline(cmd_file, line)) {
-    // It is the same case of the file not existing. Se the previous comment.
+  return std::string{content.c_str()};
+}
+
+// Fetch the cgroup the process belongs to.
+//
+// In Linux systems the cgroups of a process are listed in the file
+// "/proc/<pid>/cgroup", one line per hierarchy. The unified (v2) hierarchy is
+// the one with the id 0 and no controllers, i.e., the line "0::<path>".
+std::string FetchCgroupPath(const int pid,
+                            std::pmr::memory_resource* resource) {
+  std::pmr::string content{resource};
+  if (!parser_helper::TryReadFile(
+          parser_helper::ProcessFilePath(pid, "cgroup", resource).c_str(),
+          content)) {
     return "-";
   }
-  return line;
+  const std::string_view path{parser_helper::FindValue(content, "0::")};
+  return path.empty() ? "-" : std::string{path};
 }
 
 // On Linux systems we can find the user that is running a process in the file
 // "/proc/<pid>/status" as the Uid property.
-const UserInfo FetchProcessOwnerUidAndName(const int pid,
-                                           UidResolver* uid_resolver) {
-  const char* kStatusFilePathMask{"/proc/{}/status"};
-  std::string file_path{std::format(kStatusFilePathMask, pid)};
-
-  std::ifstream status_file{file_path};
-  if (!status_file) {
+const UserInfo FetchProcessOwnerUidAndName(
+    const int pid, UidResolver* uid_resolver,
+    std::pmr::memory_resource* resource) {
+  std::pmr::string content{resource};
+  if (!parser_helper::TryReadFile(
+          parser_helper::ProcessFilePath(pid, "status", resource).c_str(),
+          content)) {
     // This error can happen if process file is deleted between the time
     // we discover its pid and we try to get information about it. In this case
     // the process will be removed in the next iteration, so we just return a
     // dummy value here.
     return UserInfo{0, "-"};
   }
-  std::string line{};
-  while (std::getline(status_file, line)) {
-    if (line.substr(0, 4) == "Uid:") {
-      std::istringstream line_parser{line.substr(5)};
-      int uid{};
-      line_parser >> uid;
-
-      return UserInfo{uid, uid_resolver->FetchUserName(uid).value_or(
-                               std::format("UID({})", uid))};
-    }
+  const std::string_view uid_value{parser_helper::FindValue(content, "Uid:")};
+  if (uid_value.empty()) {
+    return UserInfo{0, "-"};
   }
-  return UserInfo{0, "-"};
+  const int uid{parser_helper::FieldTokenizer{uid_value}.NextNumber<int>()};
+  return UserInfo{uid, uid_resolver->FetchUserName(uid).value_or(
+                           std::format("UID({})", uid))};
 }
 
 }  // namespace
 
 Process::Process(const int pid, const system_clock::time_point boot_time,
-                 UidResolver* uid_resolver)
+                 UidResolver* uid_resolver,
+                 std::pmr::memory_resource* resource)
     : pid_{pid},
       boot_time_{boot_time},
-      process_start_time_{CalculateProcessStartTime(pid, boot_time)},
-      command_line_{FetchCommandLine(pid)},
-      last_cpu_utilization_check_(CalculateProcessStartTime(pid, boot_time)) {
-  const UserInfo user_info = FetchProcessOwnerUidAndName(pid, uid_resolver);
+      process_start_time_{CalculateProcessStartTime(pid, boot_time, resource)},
+      cgroup_path_{FetchCgroupPath(pid, resource)} {
+  const UserInfo user_info =
+      FetchProcessOwnerUidAndName(pid, uid_resolver, resource);
   uid_ = user_info.uid;
   username_ = user_info.name;
 }
 
 int Process::Pid() const { return pid_; }
 
-float Process::CpuUtilization() {
+float Process::CpuUtilization(const TickSample& sample,
+                              std::pmr::memory_resource* resource) {
   // In Linux systems we can calculate the process CPU utilization by inspecting
   // some values found in the file "/proc/<pid>/stat".
-  // We calculate the CPU utilization considering the time spent in CPU since
-  // the last measurement and the time since last measurement. So in the first
-  // call, it will calculate the average usage of cpu since the process started.
-
-  // We have no way to measure the cpu utilization if the process has just
-  // started.
-  if (UpTime() == 0) {
-    return 0;
+  // We calculate the CPU utilization as the CPU time spent by the process since
+  // the last measurement, relative to the CPU time of the whole system in the
+  // same interval. Both are measured in clock ticks, and the system time is
+  // taken once per tick, so no clock is read here. In the first call, it will
+  // calculate the average usage of cpu since the process started.
+  if (sample.time == last_cpu_sample_) {
+    return cpu_utilization_;
   }
 
-  const char* kStatFilePathMask{"/proc/{}/stat"};
-  std::string file_path{std::format(kStatFilePathMask, Pid())};
-  std::ifstream stat_file{file_path};
-  if (!stat_file) {
+  std::pmr::string content{resource};
+  if (!parser_helper::TryReadFile(
+          parser_helper::ProcessFilePath(Pid(), "stat", resource).c_str(),
+          content)) {
     // The process related files can be deleted between the time we discover its
     // pid and we try to get information about it. In this case the process will
     // be removed in the next iteration. So we just return a dummy value here.
-    return 0;
+    last_cpu_sample_ = sample.time;
+    cpu_utilization_ = 0;
+    return cpu_utilization_;
   }
-  std::string line{};
-  if (!std::getline(stat_file, line)) {
-    // It is the same case of the previous comment. We just return a dummy
-    // value.
-    return 0;
-  }
-  system_clock::time_point measured_at = system_clock::now();
-  std::istringstream line_parser{line};
-  // ignore first 13 values in the first line (they are delimited by a ' ' char)
-  for (int i = 0; i < 13; i++) {
-    line_parser.ignore(std::numeric_limits<std::streamsize>::max(), ' ');
+  UpdateCpuUtilization(sample, content);
+  return cpu_utilization_;
+}
+
+void Process::UpdateCpuUtilization(const TickSample& sample,
+                                   std::string_view stat_content) {
+  last_cpu_sample_ = sample.time;
+  cpu_utilization_ = 0;
+  if (stat_content.empty()) {
+    return;
   }
+  parser_helper::FieldTokenizer tokenizer{
+      StatFieldsAfterCommand(stat_content)};
+  // ignore the properties 3 to 13
+  tokenizer.Skip(11);
   // Amount of time that this process has been scheduled in  user  mode
-  long utime{};  // it is the 14th property in the line.
-  line_parser >> utime;
-
-  // Amount  of  time  that this process has been scheduled in kernel mode.
-  long stime{};  // it is the 15th property in the line
-  line_parser >> stime;
-
-  // Amount of time that this process's waited-for children have been scheduled
-  // in user mode
-  long cutime{};  // it is the 16th property in the line
-  line_parser >> cutime;
+  // (it is the 14th property in the line).
+  long long utime{tokenizer.NextNumber<long long>()};
+
+  // Amount  of  time  that this process has been scheduled in kernel mode
+  // (it is the 15th property in the line).
+  long long stime{tokenizer.NextNumber<long long>()};
+
+  // We don't consider the time of the waited-for children (cutime and cstime),
+  // since it was already accounted to the children while they ran, and it is
+  // added to the parent all at once when they are waited for.
+  const long long cpu_ticks{utime + stime};
+
+  long long system_ticks_delta{sample.cpu.total - last_system_cpu_ticks_};
+  if (last_system_cpu_ticks_ == 0) {
+    // In the first call we consider the system CPU time since the process
+    // started (the 22th property), as the time since the boot multiplied by
+    // the number of CPUs.
+    tokenizer.Skip(6);
+    const long long start_time_ticks{tokenizer.NextNumber<long long>()};
+    system_ticks_delta -= start_time_ticks * sample.cpu.cpu_count;
+  }
+  const long long cpu_ticks_delta{cpu_ticks - last_cpu_ticks_};
 
-  // Amount of time that this process's waited-for children have  been scheduled
-  // in  kernel mode
-  long cstime{};  // it is the 17th property in the line
-  line_parser >> cstime;
+  last_system_cpu_ticks_ = sample.cpu.total;
+  last_cpu_ticks_ = cpu_ticks;
 
-  // We are considering cutime and cstime, so the time spent by child processes
-  // will be accounted too.
-  long total_time_spent_ticks = utime + stime + cutime + cstime;
-  long total_time_spent_ms =
-      1'000 * total_time_spent_ticks / sysconf(_SC_CLK_TCK);
+  // We have no way to measure the cpu utilization if the process has just
+  // started.
+  if (system_ticks_delta > 0) {
+    cpu_utilization_ = cpu_ticks_delta * 1.0f / system_ticks_delta;
+  }
+}
 
-  long time_since_last_measurement_ms =
-      duration_cast<milliseconds>(measured_at - last_cpu_utilization_check_)
-          .count();
+std::chrono::steady_clock::time_point Process::CpuSampledAt() const {
+  return last_cpu_sample_;
+}
 
-  long time_spent_delta = total_time_spent_ms - last_cpu_time_spent_ms_;
+const string& Process::Command(std::pmr::memory_resource* resource) const {
+  if (!command_line_read_) {
+    command_line_ = FetchCommandLine(pid_, resource);
+    command_line_read_ = true;
+  }
+  return command_line_;
+}
 
-  last_cpu_utilization_check_ = measured_at;
-  last_cpu_time_spent_ms_ = total_time_spent_ms;
+const string& Process::CgroupPath() const { return cgroup_path_; }
 
-  return time_spent_delta * 1.0 / time_since_last_measurement_ms;
+string Process::Ram(std::pmr::memory_resource* resource) {
+  const long memory_usage_in_kB{RamKilobytes(resource)};
+  if (memory_usage_in_kB < 0) {
+    return "-";
+  }
+  return std::format("{} MB", memory_usage_in_kB /
+                                  1024);  // convert to megabytes and return
 }
 
-string Process::Command() const { return command_line_; }
-
-string Process::Ram() {
+long Process::RamKilobytes(std::pmr::memory_resource* resource) {
   // In Linux systems the amount of memory used by a process is available in the
   // file "/proc/<pid>/status" as the VmRSS property. We could also use VmSize,
   // however it accounts for the virtual memory allocated by the process, which
   // can be higher than the actual phisical available memory, which can be
   // confusing.
-  const char* kStatusFilePathMask{"/proc/{}/status"};
-  std::ifstream status_file{std::format(kStatusFilePathMask, Pid())};
-  if (!status_file) {
+  std::pmr::string content{resource};
+  if (!parser_helper::TryReadFile(
+          parser_helper::ProcessFilePath(Pid(), "status", resource).c_str(),
+          content)) {
     // The process related files can be deleted between the time we discover its
     // pid and we try to get information about it. In this case the process will
     // be removed in the next iteration. So we just return a dummy value here.
-    return "-";
+    return -1;
   }
-  std::string line{};
-  while (std::getline(status_file, line)) {
-    if (line.substr(0, 5) == "VmRSS") {
-      long memory_usage_in_kB = std::stol(line.substr(7));
-      return std::format("{} MB", memory_usage_in_kB /
-                                      1024);  // convert to megabytes and return
-    }
+  return RamKilobytes(content);
+}
+
+long Process::RamKilobytes(const std::string_view status_content) const {
+  const std::string_view rss_value{
+      parser_helper::FindValue(status_content, "VmRSS:")};
+  if (rss_value.empty()) {
+    // Kernel threads have no memory of their own.
+    return -1;
   }
-  return "-";
+  return parser_helper::FieldTokenizer{rss_value}.NextNumber<long>(-1);
 }
 
-string Process::User() const { return username_; }
+bool Process::UpdateMemoryDetail(
+    const std::chrono::steady_clock::time_point now,
+    std::pmr::memory_resource* resource) {
+  // The sample time is updated even if the read fails, so the scheduler
+  // doesn't retry it every tick.
+  memory_detail_sampled_at_ = now;
+  std::pmr::string content{resource};
+  if (!parser_helper::TryReadFile(
+          parser_helper::ProcessFilePath(Pid(), "smaps_rollup", resource)
+              .c_str(),
+          content)) {
+    return false;
+  }
+  // The file has the totals of all mappings, one "<key>: <value> kB" per line.
+  const std::string_view pss_value{parser_helper::FindValue(content, "Pss:")};
+  if (pss_value.empty()) {
+    // Kernel threads have no mappings.
+    return false;
+  }
+  pss_kilobytes_ =
+      parser_helper::FieldTokenizer{pss_value}.NextNumber<long long>();
+  uss_kilobytes_ =
+      parser_helper::FieldTokenizer{
+          parser_helper::FindValue(content, "Private_Clean:")}
+          .NextNumber<long long>() +
+      parser_helper::FieldTokenizer{
+          parser_helper::FindValue(content, "Private_Dirty:")}
+          .NextNumber<long long>();
+  return true;
+}
+
+long long Process::PssKilobytes() const { return pss_kilobytes_; }
+
+long long Process::UssKilobytes() const { return uss_kilobytes_; }
+
+std::chrono::steady_clock::time_point Process::MemoryDetailSampledAt() const {
+  return memory_detail_sampled_at_;
+}
+
+int Process::Uid() const { return uid_; }
+
+const string& Process::User() const { return username_; }
 
 long int Process::UpTime() const {
   return duration_cast<seconds>(system_clock::now() - process_start_time_)
       .count();
 }
 
+void Process::UpdateSchedulerStats(
+    const std::chrono::steady_clock::time_point now,
+    std::pmr::memory_resource* resource) {
+  if (now == last_scheduler_sample_) {
+    return;
+  }
+  std::pmr::string schedstat_content{resource};
+  if (!parser_helper::TryReadFile(
+          parser_helper::ProcessFilePath(Pid(), "schedstat", resource).c_str(),
+          schedstat_content)) {
+    // The process related files can be deleted between the time we discover its
+    // pid and we try to get information about it. In this case the process will
+    // be removed in the next iteration, so we keep the previous values.
+    return;
+  }
+  std::pmr::string status_content{resource};
+  parser_helper::TryReadFile(
+      parser_helper::ProcessFilePath(Pid(), "status", resource).c_str(),
+      status_content);
+  UpdateSchedulerStats(now, schedstat_content, status_content);
+}
+
+void Process::UpdateSchedulerStats(
+    const std::chrono::steady_clock::time_point now,
+    const std::string_view schedstat_content,
+    const std::string_view status_content) {
+  if (now == last_scheduler_sample_ || schedstat_content.empty()) {
+    return;
+  }
+  // The "/proc/<pid>/schedstat" file has three values: the time spent on the
+  // CPU and the time spent waiting on a run queue, both in nanoseconds, and
+  // the number of timeslices run on a CPU.
+  parser_helper::FieldTokenizer tokenizer{schedstat_content};
+  tokenizer.Skip(1);  // time spent on the CPU
+  const long long run_queue_wait_ns{tokenizer.NextNumber<long long>()};
+  const long long timeslices{tokenizer.NextNumber<long long>()};
+
+  // The context switches are counted in the "/proc/<pid>/status" file.
+  long long voluntary_context_switches{last_voluntary_context_switches_};
+  long long involuntary_context_switches{last_involuntary_context_switches_};
+  if (!status_content.empty()) {
+    voluntary_context_switches =
+        parser_helper::FieldTokenizer{
+            parser_helper::FindValue(status_content,
+                                     "voluntary_ctxt_switches:")}
+            .NextNumber<long long>();
+    involuntary_context_switches =
+        parser_helper::FieldTokenizer{
+            parser_helper::FindValue(status_content,
+                                     "nonvoluntary_ctxt_switches:")}
+            .NextNumber<long long>();
+  }
+
+  // In the first sample we only store the counters, since the rates since the
+  // process start are not meaningful for a starvation indicator.
+  if (last_scheduler_sample_ != std::chrono::steady_clock::time_point{}) {
+    const double elapsed_seconds{
+        std::chrono::duration<double>(now - last_scheduler_sample_).count()};
+    run_queue_delay_ =
+        (run_queue_wait_ns - last_run_queue_wait_ns_) / (elapsed_seconds * 1e9);
+    timeslices_per_second_ = (timeslices - last_timeslices_) / elapsed_seconds;
+    voluntary_context_switches_per_second_ =
+        (voluntary_context_switches - last_voluntary_context_switches_) /
+        elapsed_seconds;
+    involuntary_context_switches_per_second_ =
+        (involuntary_context_switches - last_involuntary_context_switches_) /
+        elapsed_seconds;
+  }
+  last_scheduler_sample_ = now;
+  last_run_queue_wait_ns_ = run_queue_wait_ns;
+  last_timeslices_ = timeslices;
+  last_voluntary_context_switches_ = voluntary_context_switches;
+  last_involuntary_context_switches_ = involuntary_context_switches;
+}
+
+std::chrono::steady_clock::time_point Process::SchedulerStatsSampledAt()
+    const {
+  return last_scheduler_sample_;
+}
+
+float Process::RunQueueDelay() const { return run_queue_delay_; }
+
+float Process::TimeslicesPerSecond() const { return timeslices_per_second_; }
+
+float Process::VoluntaryContextSwitchesPerSecond() const {
+  return voluntary_context_switches_per_second_;
+}
+
+float Process::InvoluntaryContextSwitchesPerSecond() const {
+  return involuntary_context_switches_per_second_;
+}
+
+void Process::UpdateNumaPlacement(
+    const std::chrono::steady_clock::time_point now,
+    const std::chrono::milliseconds max_age,
+    std::pmr::memory_resource* resource) {
+  if (numa_sampled_at_ != std::chrono::steady_clock::time_point{} &&
+      now - numa_sampled_at_ < max_age) {
+    return;
+  }
+  numa_sampled_at_ = now;
+  if (!ReadNumaPlacement(Pid(), numa_kilobytes_, resource)) {
+    numa_kilobytes_.clear();
+  }
+}
+
+const std::vector<long long>& Process::NumaKilobytes() const {
+  return numa_kilobytes_;
+}
+
+void Process::UpdateSocketCount(
+    const std::chrono::steady_clock::time_point now,
+    const std::chrono::milliseconds max_age) {
+  if (socket_count_sampled_at_ != std::chrono::steady_clock::time_point{} &&
+      now - socket_count_sampled_at_ < max_age) {
+    return;
+  }
+  socket_count_sampled_at_ = now;
+  socket_count_ = CountProcessSockets(Pid());
+}
+
+int Process::SocketCount() const { return socket_count_; }
+
 bool Process::operator<(Process const& a) const {
   // This function was implemented in such a way that when sorting a list of
   // processes we promote the ones with higher UIDs (that tend to be the uids of
   // non-reserved system users), and then promote more recent launched jobs
   // (higher pids).
-  if (User() == a.User()) {
+  if (uid_ == a.uid_) {
     return Pid() > a.Pid();
   }
   return uid_ > a.uid_;
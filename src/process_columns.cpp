@@ -0,0 +1,227 @@
+#include "process_columns.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "format.h"
+#include "parser_helper.h"
+
+namespace process_columns {
+namespace {
+
+// The placement of the memory in the NUMA nodes changes slowly and reading it
+// is expensive, so it is refreshed at a lower rate than the other metrics.
+const std::chrono::seconds kNumaRefreshInterval{5};
+
+// The sockets of a process are counted by scanning its file descriptors, so
+// they are refreshed at a lower rate than the other metrics.
+const std::chrono::seconds kSocketRefreshInterval{5};
+
+// Format the arguments into the context buffer, truncating the result if it
+// doesn't fit.
+template <typename... Args>
+std::string_view FormatCell(ColumnContext& context, const char* format,
+                            const Args&... args) {
+  std::array<char, 32>& buffer{context.buffer};
+  const auto result =
+      fmt::format_to_n(buffer.data(), buffer.size(), format, args...);
+  return std::string_view{
+      buffer.data(), std::min(static_cast<std::size_t>(result.size),
+                              buffer.size())};
+}
+
+// Get the slot of a file in the ProcessFiles contents.
+std::size_t FileSlot(ProcessFile file) {
+  switch (file) {
+    case kStatusFile:
+      return 1;
+    case kSchedstatFile:
+      return 2;
+    default:
+      return 0;
+  }
+}
+
+// Sample the scheduler statistics with the shared files, if they were not
+// sampled in the tick yet.
+void UpdateSchedulerStats(Process& process, ColumnContext& context) {
+  if (process.SchedulerStatsSampledAt() == context.sample.time) {
+    return;
+  }
+  process.UpdateSchedulerStats(context.sample.time,
+                               context.files.Get(kSchedstatFile),
+                               context.files.Get(kStatusFile));
+}
+
+}  // namespace
+
+ProcessFiles::ProcessFiles(const int pid, std::pmr::memory_resource* resource)
+    : pid_{pid},
+      contents_{std::pmr::string{resource}, std::pmr::string{resource},
+                std::pmr::string{resource}} {}
+
+std::string_view ProcessFiles::Get(const ProcessFile file) {
+  const std::size_t slot{FileSlot(file)};
+  if (!read_[slot]) {
+    constexpr std::array<std::string_view, 3> kNames{"stat", "status",
+                                                     "schedstat"};
+    std::pmr::string& content{contents_[slot]};
+    // The process related files can be deleted between the time we discover
+    // its pid and we try to get information about it. In this case the
+    // content is empty, and the process is removed in the next iteration.
+    if (!parser_helper::TryReadFile(
+            parser_helper::ProcessFilePath(pid_, kNames[slot],
+                                           content.get_allocator().resource())
+                .c_str(),
+            content)) {
+      content.clear();
+    }
+    read_[slot] = true;
+  }
+  return contents_[slot];
+}
+
+std::string_view PidColumn::Format(Process& process, ColumnContext& context) {
+  return FormatCell(context, "{}", process.Pid());
+}
+
+std::string_view UserColumn::Format(Process& process, ColumnContext&) {
+  return process.User();
+}
+
+bool UserColumn::Less(const Process& a, const Process& b) { return a < b; }
+
+void CpuColumn::Update(Process& process, ColumnContext& context) {
+  // The utilization may be calculated for every process in the tick already
+  // (see System::SampleProcessesCpu).
+  if (process.CpuSampledAt() != context.sample.time) {
+    process.UpdateCpuUtilization(context.sample, context.files.Get(kStatFile));
+  }
+}
+
+std::string_view CpuColumn::Format(Process& process, ColumnContext& context) {
+  // The value was calculated by Update(), so no file is read here.
+  const float cpu{
+      process.CpuUtilization(context.sample, context.resource) * 100};
+  return FormatCell(context, "{:f}", cpu).substr(0, 4);
+}
+
+std::string_view RamColumn::Format(Process& process, ColumnContext& context) {
+  const long kilobytes{process.RamKilobytes(context.files.Get(kStatusFile))};
+  if (kilobytes < 0) {
+    return "-";
+  }
+  return FormatCell(context, "{} MB", kilobytes / 1024);
+}
+
+std::string_view PssUssColumn::Format(Process& process,
+                                      ColumnContext& context) {
+  // The values are refreshed by the scheduler, so they may be old. The stale
+  // ones are marked with a '*'.
+  context.stale = context.memory_detail == nullptr ||
+                  context.memory_detail->IsStale(
+                      process.MemoryDetailSampledAt(), context.sample.time);
+  if (process.PssKilobytes() < 0) {
+    return "-";
+  }
+  return FormatCell(context, "{}/{}{}", process.PssKilobytes() / 1024,
+                    process.UssKilobytes() / 1024, context.stale ? "*" : "");
+}
+
+std::string_view TimeColumn::Format(Process& process, ColumnContext& context) {
+  return FormatCell(context, "{}", Format::ElapsedTime(process.UpTime()));
+}
+
+void RunQueueDelayColumn::Update(Process& process, ColumnContext& context) {
+  UpdateSchedulerStats(process, context);
+}
+
+std::string_view RunQueueDelayColumn::Format(Process& process,
+                                             ColumnContext& context) {
+  return FormatCell(context, "{:.1f}", process.RunQueueDelay() * 100);
+}
+
+bool RunQueueDelayColumn::Less(const Process& a, const Process& b) {
+  return a.RunQueueDelay() > b.RunQueueDelay();
+}
+
+void ContextSwitchesColumn::Update(Process& process, ColumnContext& context) {
+  UpdateSchedulerStats(process, context);
+}
+
+std::string_view ContextSwitchesColumn::Format(Process& process,
+                                               ColumnContext& context) {
+  return FormatCell(context, "{:.0f}/{:.0f}",
+                    process.VoluntaryContextSwitchesPerSecond(),
+                    process.InvoluntaryContextSwitchesPerSecond());
+}
+
+bool ContextSwitchesColumn::Less(const Process& a, const Process& b) {
+  return a.VoluntaryContextSwitchesPerSecond() +
+             a.InvoluntaryContextSwitchesPerSecond() >
+         b.VoluntaryContextSwitchesPerSecond() +
+             b.InvoluntaryContextSwitchesPerSecond();
+}
+
+void NumaColumn::Update(Process& process, ColumnContext& context) {
+  process.UpdateNumaPlacement(context.sample.time, kNumaRefreshInterval,
+                              context.resource);
+}
+
+std::string_view NumaColumn::Format(Process& process, ColumnContext& context) {
+  const std::vector<long long>& numa_kilobytes{process.NumaKilobytes()};
+  long long total_kilobytes{0};
+  for (const long long kilobytes : numa_kilobytes) {
+    total_kilobytes += kilobytes;
+  }
+  if (total_kilobytes <= 0) {
+    return "-";
+  }
+  auto output = context.buffer.data();
+  const auto buffer_end = context.buffer.data() + context.buffer.size();
+  for (std::size_t node = 0; node < numa_kilobytes.size(); ++node) {
+    output = fmt::format_to_n(output, buffer_end - output, "{}{}",
+                              node > 0 ? "/" : "",
+                              numa_kilobytes[node] * 100 / total_kilobytes)
+                 .out;
+  }
+  return std::string_view{context.buffer.data(),
+                          static_cast<std::size_t>(
+                              std::min(output, buffer_end) -
+                              context.buffer.data())};
+}
+
+void SocketsColumn::Update(Process& process, ColumnContext& context) {
+  process.UpdateSocketCount(context.sample.time, kSocketRefreshInterval);
+}
+
+std::string_view SocketsColumn::Format(Process& process,
+                                       ColumnContext& context) {
+  if (process.SocketCount() < 0) {
+    return "-";
+  }
+  return FormatCell(context, "{}", process.SocketCount());
+}
+
+std::string_view CgroupColumn::Format(Process& process,
+                                      ColumnContext& context) {
+  const std::string_view path{process.CgroupPath()};
+  const std::size_t width{kWidth - 1};
+  if (path.size() <= width) {
+    return path;
+  }
+  return FormatCell(context, "...{}", path.substr(path.size() - width + 3));
+}
+
+std::string_view CommandColumn::Format(Process& process,
+                                       ColumnContext& context) {
+  return process.Command(context.resource);
+}
+
+}  // namespace process_columns
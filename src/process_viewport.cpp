@@ -0,0 +1,87 @@
+#include "process_viewport.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "process.h"
+
+namespace {
+
+// A move larger than any list, used to go to its ends.
+const long long kListEnd{std::numeric_limits<int>::max()};
+
+}  // namespace
+
+void ProcessViewport::Resize(const int rows) { rows_ = std::max(rows, 1); }
+
+int ProcessViewport::Rows() const { return rows_; }
+
+void ProcessViewport::Move(const int rows) {
+  pending_move_ = std::clamp(pending_move_ + rows, -kListEnd, kListEnd);
+}
+
+void ProcessViewport::PageUp() { Move(-rows_); }
+
+void ProcessViewport::PageDown() { Move(rows_); }
+
+void ProcessViewport::Home() { pending_move_ = -kListEnd; }
+
+void ProcessViewport::End() { pending_move_ = kListEnd; }
+
+void ProcessViewport::SelectPid(const int pid) {
+  requested_pid_ = pid;
+  pending_move_ = 0;
+}
+
+void ProcessViewport::Update(const std::vector<Process>& processes) {
+  if (processes.empty()) {
+    first_ = 0;
+    selected_index_ = 0;
+    pending_move_ = 0;
+    requested_pid_ = -1;
+    return;
+  }
+  // The selected process is searched by PID. If it finished, the process that
+  // took its position is selected.
+  const auto find = [&processes](const int pid) {
+    return std::find_if(
+        processes.begin(), processes.end(),
+        [pid](const Process& process) { return process.Pid() == pid; });
+  };
+  auto selected = processes.end();
+  if (requested_pid_ >= 0) {
+    selected = find(requested_pid_);
+    requested_pid_ = -1;
+  }
+  if (selected == processes.end()) {
+    selected = find(selected_pid_);
+  }
+  const long long last{static_cast<long long>(processes.size()) - 1};
+  long long index{selected != processes.end()
+                      ? selected - processes.begin()
+                      : std::min(static_cast<long long>(selected_index_),
+                                 last)};
+  index = std::clamp(index + pending_move_, 0LL, last);
+  pending_move_ = 0;
+  selected_index_ = static_cast<std::size_t>(index);
+  selected_pid_ = processes[selected_index_].Pid();
+
+  // The viewport only scrolls when the selection goes out of it, and it is
+  // kept full when the list is long enough.
+  const std::size_t rows{static_cast<std::size_t>(rows_)};
+  if (selected_index_ < first_) {
+    first_ = selected_index_;
+  } else if (selected_index_ >= first_ + rows) {
+    first_ = selected_index_ + 1 - rows;
+  }
+  first_ = std::min(first_, processes.size() - std::min(rows,
+                                                        processes.size()));
+}
+
+std::size_t ProcessViewport::First() const { return first_; }
+
+std::size_t ProcessViewport::SelectedIndex() const { return selected_index_; }
+
+int ProcessViewport::SelectedPid() const { return selected_pid_; }
@@ -1,17 +1,21 @@
 #include "processor.h"
 
-#include <fstream>
-#include <limits>
-#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <memory_resource>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 
 #include "format.h"
+#include "parser_helper.h"
 
-float Processor::Utilization() {
+CpuTimes Processor::Times(std::pmr::memory_resource* resource) const {
   const char* kStatFilePath{"/proc/stat"};
 
-  std::ifstream stat_file{kStatFilePath};
-  if (!stat_file) {
+  std::pmr::string content{resource};
+  if (!parser_helper::TryReadFile(kStatFilePath, content)) {
     throw std::logic_error(
         std::format("Could not open the stat file: {}", kStatFilePath));
   }
@@ -45,50 +49,123 @@ float Processor::Utilization() {
   // - guest: running a normal guest
   // - guest_nice: running a niced guest
 
-  std::string line{};
-  if (!std::getline(stat_file, line)) {
+  const std::string_view line{
+      std::string_view{content}.substr(0, content.find('\n'))};
+  if (line.empty()) {
     throw std::logic_error(std::format(
         "Could not read first line from stat file: {}", kStatFilePath));
   }
-  std::istringstream line_parser{line};
+  parser_helper::FieldTokenizer line_parser{line};
   // discard cpu prefix
-  line_parser.ignore(std::numeric_limits<std::streamsize>::max(), ' ');
-  long user{};
-  line_parser >> user;
-  long nice{};
-  line_parser >> nice;
-  long system{};
-  line_parser >> system;
-  long idle{};
-  line_parser >> idle;
-  long iowait{};
-  line_parser >> iowait;
-  long irq{};
-  line_parser >> irq;
-  long softirq{};
-  line_parser >> softirq;
-  long steal{};
-  line_parser >> steal;
-  long guest{};
-  line_parser >> guest;
-  long guest_nice{};
-  line_parser >> guest_nice;
+  line_parser.Skip(1);
+  long long user{line_parser.NextNumber<long long>()};
+  long long nice{line_parser.NextNumber<long long>()};
+  long long system{line_parser.NextNumber<long long>()};
+  long long idle{line_parser.NextNumber<long long>()};
+  long long iowait{line_parser.NextNumber<long long>()};
+  long long irq{line_parser.NextNumber<long long>()};
+  long long softirq{line_parser.NextNumber<long long>()};
+  long long steal{line_parser.NextNumber<long long>()};
 
-  // The time the processor was active, i.e., doing work.
-  long operation_time = user + nice + system + irq + softirq + steal;
+  CpuTimes times{};
   // The time the processor was in idle state.
-  long idle_time = idle + iowait;
-  long total_time = operation_time + idle_time;
+  times.idle = idle + iowait;
+  // The time the processor was active, i.e., doing work, plus the idle time.
+  times.total = user + nice + system + irq + softirq + steal + times.idle;
 
-  // We compute the usage based on the delta of processor time between the last
-  // time we measured and now.
-  long total_delta = total_time - previous_total_time_;
-  long idle_delta = idle_time - previous_idle_time_;
+  // The next lines are the times of each CPU ("cpu0", "cpu1", ...), which we
+  // only count.
+  std::string_view remaining{content};
+  remaining.remove_prefix(std::min(line.size() + 1, remaining.size()));
+  while (remaining.substr(0, 3) == "cpu") {
+    ++times.cpu_count;
+    const std::size_t line_end{
+        std::min(remaining.find('\n'), remaining.size())};
+    remaining.remove_prefix(std::min(line_end + 1, remaining.size()));
+  }
+  return times;
+}
+
+float Processor::Utilization(const TickSample& sample) {
+  if (sample.time == last_utilization_tick_) {
+    return utilization_;
+  }
+  // We compute the usage based on the delta of processor time between the
+  // previous tick and this one.
+  const long long total_delta{sample.cpu.total - previous_times_.total};
+  const long long idle_delta{sample.cpu.idle - previous_times_.idle};
 
   // Store the current values for the next measurement.
-  previous_total_time_ = total_time;
-  previous_idle_time_ = idle_time;
+  previous_times_ = sample.cpu;
+  last_utilization_tick_ = sample.time;
 
-  float usage = (total_delta - idle_delta) * 1.0 / total_delta;
-  return usage;
+  utilization_ =
+      total_delta > 0 ? (total_delta - idle_delta) * 1.0f / total_delta : 0;
+  return utilization_;
+}
+
+RunQueueStats Processor::RunQueueDelay(const TickSample& sample,
+                                       std::pmr::memory_resource* resource) {
+  if (sample.time == previous_run_queue_check_) {
+    return run_queue_stats_;
+  }
+  const char* kSchedStatFilePath{"/proc/schedstat"};
+  std::pmr::string content{resource};
+  if (!parser_helper::TryReadFile(kSchedStatFilePath, content)) {
+    // The file is only available when the kernel is built with
+    // CONFIG_SCHEDSTATS.
+    return RunQueueStats{};
+  }
+  const auto now = sample.time;
+
+  // The file has one line per CPU with the format:
+  // cpu<N> <yld_count> <legacy> <sched_count> <sched_goidle> <ttwu_count>
+  // <ttwu_local> <rq_cpu_time> <run_delay> <pcount>
+  // where run_delay is the time (in nanoseconds) the tasks spent waiting to run
+  // in the CPU run queue and pcount is the number of timeslices run in the CPU.
+  long long run_delay_ns{0};
+  long long timeslices{0};
+  int cpus{0};
+  std::string_view remaining{content};
+  while (!remaining.empty()) {
+    const std::size_t line_end{
+        std::min(remaining.find('\n'), remaining.size())};
+    const std::string_view line{remaining.substr(0, line_end)};
+    remaining.remove_prefix(std::min(line_end + 1, remaining.size()));
+    if (line.substr(0, 3) != "cpu") {
+      continue;
+    }
+    parser_helper::FieldTokenizer tokenizer{line};
+    tokenizer.Skip(8);
+    run_delay_ns += tokenizer.NextNumber<long long>();
+    timeslices += tokenizer.NextNumber<long long>();
+    ++cpus;
+  }
+
+  // In the first call we consider the time since the boot.
+  double elapsed_ns{
+      std::chrono::duration<double, std::nano>(now -
+                                               previous_run_queue_check_)
+          .count()};
+  if (previous_run_queue_check_ == std::chrono::steady_clock::time_point{}) {
+    timespec boot_time{};
+    clock_gettime(CLOCK_BOOTTIME, &boot_time);
+    elapsed_ns = boot_time.tv_sec * 1e9 + boot_time.tv_nsec;
+  }
+  const long long run_delay_delta{run_delay_ns - previous_run_delay_ns_};
+  const long long timeslices_delta{timeslices - previous_timeslices_};
+  previous_run_delay_ns_ = run_delay_ns;
+  previous_timeslices_ = timeslices;
+  previous_run_queue_check_ = now;
+
+  run_queue_stats_ = RunQueueStats{};
+  run_queue_stats_.available = cpus > 0;
+  if (cpus > 0 && elapsed_ns > 0) {
+    run_queue_stats_.delay = run_delay_delta / (elapsed_ns * cpus);
+  }
+  if (timeslices_delta > 0) {
+    run_queue_stats_.delay_per_timeslice_ms =
+        run_delay_delta / 1e6 / timeslices_delta;
+  }
+  return run_queue_stats_;
 }
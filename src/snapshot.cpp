@@ -0,0 +1,102 @@
+#include "snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "errors.h"
+
+SnapshotReader::SnapshotReader(const std::string& path) : path_{path} {
+  Map();
+  Refresh();
+}
+
+void SnapshotReader::Map() {
+  const int fd{open(path_.c_str(), O_RDONLY | O_CLOEXEC)};
+  if (fd < 0) {
+    throw OpenFileError{path_};
+  }
+  struct stat file_status {};
+  if (fstat(fd, &file_status) != 0 ||
+      static_cast<std::size_t>(file_status.st_size) <
+          sizeof(snapshot::Header)) {
+    close(fd);
+    throw UnexpectedFormatError{"The file " + path_ +
+                                " is not a monitor snapshot."};
+  }
+  const std::size_t size{static_cast<std::size_t>(file_status.st_size)};
+  void* address{mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0)};
+  close(fd);
+  if (address == MAP_FAILED) {
+    throw OpenFileError{path_};
+  }
+  // The slots must fit in the file and hold the records they claim to hold.
+  // The sizes are divided instead of multiplied, so they can't overflow.
+  const auto* header{static_cast<const snapshot::Header*>(address)};
+  if (header->magic != snapshot::kMagic ||
+      header->version != snapshot::kVersion || header->slot_count == 0 ||
+      header->slot_size < snapshot::SlotSize(header->process_capacity) ||
+      (size - sizeof(snapshot::Header)) / header->slot_size <
+          header->slot_count) {
+    munmap(address, size);
+    throw UnexpectedFormatError{
+        "The file " + path_ +
+        " was not created by a compatible monitor version."};
+  }
+  if (header_ != nullptr) {
+    munmap(const_cast<snapshot::Header*>(header_), size_);
+  }
+  size_ = size;
+  header_ = header;
+  device_ = file_status.st_dev;
+  inode_ = file_status.st_ino;
+}
+
+SnapshotReader::~SnapshotReader() {
+  munmap(const_cast<snapshot::Header*>(header_), size_);
+}
+
+std::uint64_t SnapshotReader::Published() const {
+  return header_->published.load(std::memory_order_acquire);
+}
+
+void SnapshotReader::Refresh(const std::chrono::steady_clock::time_point now) {
+  // A publisher refreshes at least once per second, so a few seconds without
+  // snapshots means it is gone.
+  const std::chrono::seconds kStaleAfter{5};
+  struct stat file_status {};
+  bool replaced{stat(path_.c_str(), &file_status) != 0};
+  if (!replaced &&
+      (file_status.st_dev != device_ || file_status.st_ino != inode_)) {
+    try {
+      Map();
+      last_published_ = 0;
+    } catch (const OpenFileError&) {
+      replaced = true;
+    } catch (const UnexpectedFormatError&) {
+      replaced = true;
+    }
+  }
+  const std::uint64_t published{Published()};
+  if (published != last_published_) {
+    last_published_ = published;
+    last_publication_ = now;
+  }
+  stale_ = replaced || published == 0 || now - last_publication_ > kStaleAfter;
+}
+
+bool SnapshotReader::Stale() const { return stale_; }
+
+const snapshot::SlotHeader* SnapshotReader::SlotAt(
+    const std::uint64_t index) const {
+  const auto* slots{reinterpret_cast<const std::byte*>(header_ + 1)};
+  return reinterpret_cast<const snapshot::SlotHeader*>(
+      slots + index * header_->slot_size);
+}
@@ -0,0 +1,133 @@
+#include "snapshot_publisher.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "errors.h"
+
+namespace {
+
+// Copy a string into a fixed size field, truncating it if necessary.
+template <std::size_t N>
+void CopyField(std::string_view value, char (&field)[N]) {
+  const std::size_t size{std::min(value.size(), N - 1)};
+  std::memcpy(field, value.data(), size);
+  field[size] = '\0';
+}
+
+}  // namespace
+
+SnapshotPublisher::SnapshotPublisher(const std::string& path,
+                                     const std::uint32_t process_capacity)
+    : path_{path},
+      size_{sizeof(snapshot::Header) +
+            snapshot::kSlotCount * snapshot::SlotSize(process_capacity)} {
+  // A file left by a previous publisher is replaced instead of truncated, since
+  // its readers would crash accessing a mapping beyond the end of the file.
+  unlink(path.c_str());
+  const int fd{
+      open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644)};
+  if (fd < 0) {
+    throw OpenFileError{path};
+  }
+  if (ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+    close(fd);
+    throw OpenFileError{path};
+  }
+  void* address{
+      mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)};
+  close(fd);
+  if (address == MAP_FAILED) {
+    throw OpenFileError{path};
+  }
+  header_ = static_cast<snapshot::Header*>(address);
+  header_->magic = snapshot::kMagic;
+  header_->version = snapshot::kVersion;
+  header_->slot_count = snapshot::kSlotCount;
+  header_->process_capacity = process_capacity;
+  header_->slot_size = snapshot::SlotSize(process_capacity);
+  header_->published.store(0, std::memory_order_release);
+}
+
+SnapshotPublisher::~SnapshotPublisher() {
+  munmap(header_, size_);
+  unlink(path_.c_str());
+}
+
+snapshot::SlotHeader* SnapshotPublisher::SlotAt(
+    const std::uint64_t index) const {
+  auto* slots{reinterpret_cast<std::byte*>(header_ + 1)};
+  return reinterpret_cast<snapshot::SlotHeader*>(slots +
+                                                 index * header_->slot_size);
+}
+
+void SnapshotPublisher::Publish(System& system) {
+  std::pmr::memory_resource* resource{system.TickResource()};
+  // The sampling is done before taking the slot lock, so that the slot is
+  // locked only for the time it takes to copy the values.
+  snapshot::SystemRecord system_record{};
+  system_record.cpu_utilization = system.CpuUtilization();
+  system_record.memory_utilization = system.MemoryUtilization();
+  system_record.total_processes = system.TotalProcesses();
+  system_record.running_processes = system.RunningProcesses();
+  system_record.uptime_seconds = system.UpTime();
+  CopyField(system.OperatingSystem(), system_record.operating_system);
+  CopyField(system.Kernel(), system_record.kernel);
+
+  std::vector<Process>& processes{system.Processes()};
+  system.SampleProcessesCpu();
+  const std::uint32_t process_count{static_cast<std::uint32_t>(
+      std::min<std::size_t>(processes.size(), header_->process_capacity))};
+  std::pmr::vector<snapshot::ProcessRecord> process_records{process_count,
+                                                            resource};
+  for (std::uint32_t i = 0; i < process_count; ++i) {
+    Process& process{processes[i]};
+    snapshot::ProcessRecord& record{process_records[i]};
+    record.pid = process.Pid();
+    record.uid = process.Uid();
+    record.cpu_utilization = process.CpuUtilization(system.Sample(), resource);
+    record.ram_kb = process.RamKilobytes(resource);
+    record.uptime_seconds = process.UpTime();
+    CopyField(process.User(), record.user);
+    CopyField(process.Command(resource), record.command);
+  }
+
+  const std::uint64_t published{
+      header_->published.load(std::memory_order_relaxed)};
+  snapshot::SlotHeader* slot{SlotAt(published % header_->slot_count)};
+  const std::uint64_t sequence{slot->sequence.load(std::memory_order_relaxed)};
+  slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot->tick = ++tick_;
+  slot->timestamp_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+  slot->system = system_record;
+  slot->process_count = process_count;
+  slot->dropped_processes =
+      static_cast<std::uint32_t>(processes.size() - process_count);
+  std::memcpy(reinterpret_cast<snapshot::ProcessRecord*>(slot + 1),
+              process_records.data(),
+              process_count * sizeof(snapshot::ProcessRecord));
+
+  slot->sequence.store(sequence + 2, std::memory_order_release);
+  header_->published.store(published + 1, std::memory_order_release);
+}
+
+snapshot::SnapshotView SnapshotPublisher::Latest() const {
+  const std::uint64_t published{
+      header_->published.load(std::memory_order_relaxed)};
+  return snapshot::SnapshotView{SlotAt((published - 1) % header_->slot_count)};
+}
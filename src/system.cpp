@@ -1,14 +1,21 @@
 #include "system.h"
 
+#include <dirent.h>
 #include <unistd.h>
 
 #include <algorithm>
+#include <charconv>
 #include <chrono>
 #include <cstddef>
 #include <fstream>
-#include <set>
+#include <memory_resource>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "errors.h"
@@ -17,31 +24,15 @@
 #include "process.h"
 #include "processor.h"
 
-// We check for the support of filesystem module.
-// In the version that runs in the udacity workspace, the experimental module is
-// only available as an experimental feature.
-#ifdef USE_EXPERIMENTAL_FILESYSTEM
-#include <experimental/filesystem>
-#else
-#include <filesystem>
-#endif
-
-using std::set;
 using std::size_t;
 using std::string;
 using std::vector;
 using std::chrono::system_clock;
 
-// We check for the support of filesystem module.
-// In the version that runs in the udacity workspace, the experimental module is
-// only available as an experimental feature.
-#ifdef USE_EXPERIMENTAL_FILESYSTEM
-namespace fs = std::experimental::filesystem;
-#else
-namespace fs = std::filesystem;
-#endif
-
 namespace {
+// Maximum time spent creating new process objects in each call to Processes().
+const std::chrono::milliseconds kProcessDiscoveryBudget{50};
+
 // Inspect the OS proc directory for process descriptors.
 //
 // On Linux like systems we can find directories under "/proc/" that contains
@@ -49,30 +40,94 @@ namespace {
 // process id. So if we scan the "/proc" directory for other directories that
 // are named with a valid number, we can assume that it contains information
 // about a running process.
-std::unordered_set<int> FetchProcessIds() {
+std::pmr::unordered_set<int> FetchProcessIds(
+    std::pmr::memory_resource* resource) {
   const char* kProcDictoryPath{"/proc"};
-  std::unordered_set<int> pids{};
+  std::pmr::unordered_set<int> pids{resource};
 
-  fs::path proc_path{kProcDictoryPath};
-  if (!fs::exists(proc_path)) {
+  // We use the POSIX directory API instead of the filesystem module since the
+  // latter allocates path objects for every entry.
+  DIR* proc_dir = opendir(kProcDictoryPath);
+  if (proc_dir == nullptr) {
     throw std::logic_error(std::format(
         "Could not find the '{}' directory in this system.", kProcDictoryPath));
   }
 
   // scan all content under the proc diretory
-  for (const auto& entry : fs::directory_iterator(proc_path)) {
-    const std::string& filename{entry.path().filename().string()};
-    if (!fs::is_directory(entry) ||
-        std::any_of(
-            filename.begin(), filename.end(),
-            [](const char& character) { return !std::isdigit(character); })) {
+  while (const dirent* entry = readdir(proc_dir)) {
+    if (entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN) {
       continue;
     }
-    pids.emplace(std::stoi(filename));
+    const std::string_view filename{entry->d_name};
+    int pid{};
+    const char* filename_end{filename.data() + filename.size()};
+    const auto result = std::from_chars(filename.data(), filename_end, pid);
+    if (result.ec != std::errc{} || result.ptr != filename_end) {
+      continue;
+    }
+    pids.emplace(pid);
   }
+  closedir(proc_dir);
   return pids;
 }
 
+// Find the mount point of the unified (v2) cgroup hierarchy.
+//
+// It is usually mounted at "/sys/fs/cgroup", but systems running in the hybrid
+// mode mount the v1 controllers there and the unified hierarchy at
+// "/sys/fs/cgroup/unified". Only the v2 root has the "cgroup.controllers"
+// file. It returns an empty string if the unified hierarchy is not mounted.
+std::string FetchCgroupRoot() {
+  for (const char* root : {"/sys/fs/cgroup", "/sys/fs/cgroup/unified"}) {
+    if (access(std::format("{}/cgroup.controllers", root).c_str(), R_OK) ==
+        0) {
+      return root;
+    }
+  }
+  return {};
+}
+
+// Walk the cgroup hierarchy collecting the path of every group.
+//
+// Each directory under the hierarchy mount point is a cgroup. The paths are
+// stored relative to the mount point, like they appear in "/proc/<pid>/cgroup".
+//
+// Parameters:
+//  - root: The mount point of the cgroup hierarchy.
+//  - relative_path: The path of the group being visited.
+//  - depth: The number of ancestors of the group being visited.
+//  - paths: The list where the paths and depths are stored.
+void CollectCgroupPaths(
+    const std::string& root, const std::pmr::string& relative_path,
+    const int depth,
+    std::pmr::vector<std::pair<std::pmr::string, int>>& paths) {
+  std::pmr::memory_resource* resource{paths.get_allocator().resource()};
+  paths.emplace_back(relative_path, depth);
+
+  std::pmr::string directory_path{root, resource};
+  if (relative_path != "/") {
+    directory_path += relative_path;
+  }
+  DIR* directory = opendir(directory_path.c_str());
+  if (directory == nullptr) {
+    // The group was removed while we were walking the hierarchy.
+    return;
+  }
+  while (const dirent* entry = readdir(directory)) {
+    const std::string_view name{entry->d_name};
+    if (entry->d_type != DT_DIR || name == "." || name == "..") {
+      continue;
+    }
+    std::pmr::string child_path{relative_path, resource};
+    if (relative_path != "/") {
+      child_path += '/';
+    }
+    child_path += name;
+    CollectCgroupPaths(root, child_path, depth + 1, paths);
+  }
+  closedir(directory);
+}
+
 // Inspect the OS proc directory for the system boot time.
 //
 // On Linux like systems we can find the boot time in the file "/proc/stat" in
@@ -133,10 +188,45 @@ std::string FetchOperatingSystem() {
 System::System()
     : boot_time_{FetchBootTime()},
       kernel_version_{FetchKernelVersion()},
-      os_name_{FetchOperatingSystem()} {}
+      os_name_{FetchOperatingSystem()},
+      cgroup_root_{FetchCgroupRoot()} {}
 
 Processor& System::Cpu() { return cpu_; }
 
+PressureMonitor& System::Pressure() { return pressure_; }
+
+BudgetGovernor& System::Governor() { return governor_; }
+
+const NetworkMonitor& System::Network() {
+  network_.Update(TickTime(), TickResource());
+  return network_;
+}
+
+DiskMonitor& System::Disks() {
+  disks_.Update(TickTime(), TickResource());
+  return disks_;
+}
+
+InterruptMonitor& System::Interrupts() {
+  interrupts_.Update(TickTime(), TickResource());
+  return interrupts_;
+}
+
+void System::SetIrqImbalanceThreshold(const float threshold) {
+  interrupts_.SetImbalanceThreshold(threshold);
+}
+
+ExitAccounting& System::ExitedTasks() {
+  exited_tasks_.Update(TickTime());
+  return exited_tasks_;
+}
+
+bool System::EnableExitAccounting() { return exited_tasks_.Enable(); }
+
+const std::vector<NumaNodeStats>& System::NumaNodes() {
+  return numa_.Update(TickTime(), TickResource());
+}
+
 vector<Process>& System::Processes() {
   // Since the processes objects have internal state to calculate some metrics
   // like CPU utilization, we can't just clear the list and create new ones. So
@@ -144,46 +234,168 @@ vector<Process>& System::Processes() {
   // list that we currenlty have. We add new ones, remove those that are not
   // running anymore and just keep the same object for the ones that are still
   // running.
-  std::unordered_set<int> current_pids{FetchProcessIds()};
+  std::pmr::memory_resource* resource{TickResource()};
+  const std::pmr::unordered_set<int> current_pids{FetchProcessIds(resource)};
 
-  std::unordered_set<int> previous_pids{};
+  std::pmr::unordered_set<int> previous_pids{resource};
+  previous_pids.reserve(processes_.size());
   for (const Process& process : processes_) {
     previous_pids.emplace(process.Pid());
   }
 
-  // current_pids - previous_pids
-  std::unordered_set<int> pids_to_add{};
-  std::set_difference(current_pids.begin(), current_pids.end(),
-                      previous_pids.begin(), previous_pids.end(),
-                      std::inserter(pids_to_add, pids_to_add.begin()));
+  // remove obsolete process objects (previous_pids - current_pids)
+  processes_.erase(std::remove_if(processes_.begin(), processes_.end(),
+                                  [&current_pids](const Process& process) {
+                                    return current_pids.find(process.Pid()) ==
+                                           current_pids.end();
+                                  }),
+                   processes_.end());
 
-  // previous_pids - current_pids
-  std::unordered_set<int> pids_to_remove{};
-  std::set_difference(previous_pids.begin(), previous_pids.end(),
-                      current_pids.begin(), current_pids.end(),
-                      std::inserter(pids_to_remove, pids_to_remove.begin()));
+  // add new process objects for new pids (current_pids - previous_pids)
+  //
+  // Creating a process object reads some files, so in a host with many
+  // processes the first call would take a long time. We stop adding processes
+  // when the time budget is over, and the remaining ones are added in the next
+  // calls. This way the UI can show a partial list right away.
+  const auto deadline =
+      std::chrono::steady_clock::now() + kProcessDiscoveryBudget;
+  pending_processes_ = 0;
+  int added{0};
+  for (const int pid : current_pids) {
+    if (previous_pids.find(pid) != previous_pids.end()) {
+      continue;
+    }
+    // We only check the clock once in a while, since it is not free either.
+    if (pending_processes_ > 0 ||
+        (++added % 32 == 0 && std::chrono::steady_clock::now() > deadline)) {
+      ++pending_processes_;
+      continue;
+    }
+    processes_.emplace_back(pid, boot_time_, &uid_resolver_, resource);
+  }
+  std::sort(processes_.begin(), processes_.end());
 
-  // remove obsolete process objects
-  if (!pids_to_remove.empty()) {
-    processes_.erase(
-        std::remove_if(processes_.begin(), processes_.end(),
-                       [&pids_to_remove](const Process& process) {
-                         return pids_to_remove.find(process.Pid()) !=
-                                pids_to_remove.end();
-                       }),
-        processes_.end());
+  return processes_;
+}
+
+int System::PendingProcesses() const { return pending_processes_; }
+
+void System::SampleProcessesCpu() {
+  std::pmr::memory_resource* resource{TickResource()};
+  const TickSample& sample{Sample()};
+  std::pmr::vector<std::pmr::string> paths{resource};
+  paths.reserve(processes_.size());
+  for (const Process& process : processes_) {
+    paths.push_back(
+        parser_helper::ProcessFilePath(process.Pid(), "stat", resource));
+  }
+  std::pmr::vector<std::pmr::string> contents{resource};
+  batch_reader_.Read(paths, contents);
+  for (size_t i = 0; i < processes_.size(); ++i) {
+    // A process that finished keeps its previous value, and it is removed in
+    // the next scan.
+    if (!contents[i].empty()) {
+      processes_[i].UpdateCpuUtilization(sample, contents[i]);
+    }
   }
+}
+
+void System::RefreshExpensiveMetrics(const size_t priority_first,
+                                     const size_t priority_count) {
+  metric_scheduler_.Run(processes_, priority_first, priority_count, TickTime(),
+                        TickResource());
+}
+
+const ExpensiveMetricScheduler& System::MetricScheduler() const {
+  return metric_scheduler_;
+}
 
-  // add new process objects for new pids
-  for (const int pid : pids_to_add) {
-    processes_.emplace_back(pid, boot_time_, &uid_resolver_);
+bool System::EnableIoUring() { return batch_reader_.EnableIoUring(); }
+
+vector<Cgroup>& System::Cgroups(const CgroupSortKey sort_key) {
+  if (cgroup_root_.empty()) {
+    return cgroups_;
   }
-  std::sort(processes_.begin(), processes_.end());
+  // Like the processes, the cgroup objects keep the previous counters to
+  // calculate the rates, so we keep the objects of the groups that still exist.
+  std::pmr::memory_resource* resource{TickResource()};
+  std::pmr::vector<std::pair<std::pmr::string, int>> current_paths{resource};
+  CollectCgroupPaths(cgroup_root_, std::pmr::string{"/", resource}, 0,
+                     current_paths);
 
-  return processes_;
+  std::pmr::unordered_set<std::string_view> current_path_set{resource};
+  current_path_set.reserve(current_paths.size());
+  for (const auto& [path, depth] : current_paths) {
+    current_path_set.emplace(path);
+  }
+  std::pmr::unordered_set<std::string_view> previous_path_set{resource};
+  previous_path_set.reserve(cgroups_.size());
+  for (const Cgroup& cgroup : cgroups_) {
+    previous_path_set.emplace(cgroup.Path());
+  }
+
+  // The new groups are created in a separate list, since the previous path set
+  // points to the strings of the existing objects.
+  for (const auto& [path, depth] : current_paths) {
+    if (previous_path_set.find(path) == previous_path_set.end()) {
+      cgroups_buffer_.emplace_back(std::string{path}, depth);
+    }
+  }
+  cgroups_.erase(std::remove_if(cgroups_.begin(), cgroups_.end(),
+                                [&current_path_set](const Cgroup& cgroup) {
+                                  return current_path_set.find(cgroup.Path()) ==
+                                         current_path_set.end();
+                                }),
+                 cgroups_.end());
+  std::move(cgroups_buffer_.begin(), cgroups_buffer_.end(),
+            std::back_inserter(cgroups_));
+  cgroups_buffer_.clear();
+
+  const auto now = TickTime();
+  for (Cgroup& cgroup : cgroups_) {
+    cgroup.Update(cgroup_root_, now, resource);
+  }
+
+  // Sort all the groups by the key, then visit the tree in depth first order,
+  // so that the siblings are kept in the sorted order.
+  std::sort(cgroups_.begin(), cgroups_.end(),
+            [sort_key](const Cgroup& a, const Cgroup& b) {
+              return Cgroup::Less(a, b, sort_key);
+            });
+  std::pmr::unordered_map<std::string_view, std::pmr::vector<size_t>> children{
+      resource};
+  for (size_t i = 0; i < cgroups_.size(); ++i) {
+    children[cgroups_[i].ParentPath()].push_back(i);
+  }
+  std::pmr::vector<size_t> order{resource};
+  order.reserve(cgroups_.size());
+  std::pmr::vector<size_t> pending{resource};
+  const auto push_children = [&children, &pending](std::string_view parent) {
+    const auto it = children.find(parent);
+    if (it != children.end()) {
+      // reversed, so that the first child is the next one to be visited
+      pending.insert(pending.end(), it->second.rbegin(), it->second.rend());
+    }
+  };
+  push_children({});
+  while (!pending.empty()) {
+    const size_t index{pending.back()};
+    pending.pop_back();
+    order.push_back(index);
+    push_children(cgroups_[index].Path());
+  }
+
+  // The objects are only moved after the visit, since the keys of the children
+  // map point to their paths.
+  for (const size_t index : order) {
+    cgroups_buffer_.push_back(std::move(cgroups_[index]));
+  }
+  cgroups_.swap(cgroups_buffer_);
+  cgroups_buffer_.clear();
+  return cgroups_;
 }
 
-std::string System::Kernel() const { return kernel_version_; }
+const std::string& System::Kernel() const { return kernel_version_; }
 
 float System::MemoryUtilization() const {
   // On Unix like systems the memory info can be fetched in the file
@@ -192,38 +404,61 @@ float System::MemoryUtilization() const {
   // reported by Operating System. So buffered and cached RAM usage is also
   // considered.
   const char* kMemoryInfoFilePath{"/proc/meminfo"};
-  const auto map =
-      parser_helper::ExtractKeyValuePairsFromFile(kMemoryInfoFilePath, ":");
+  const auto map = parser_helper::ExtractKeyValuePairsFromFile(
+      kMemoryInfoFilePath, ":", tick_arena_.Resource());
 
   // All the values in the meminfo file have the format "[0-9]+ kB", so we
   // ignore the suffix kB to extract the number value.
-  const std::string& total_memory_kB_str{map.at("MemTotal")};
-  const long total_memory_kB =
-      std::stol(total_memory_kB_str.substr(0, total_memory_kB_str.size() - 3));
-  const std::string& free_memory_kB_str{map.at("MemFree")};
-  const long free_memory_kB =
-      std::stol(free_memory_kB_str.substr(0, free_memory_kB_str.size() - 3));
+  const long total_memory_kB{
+      parser_helper::FieldTokenizer{map.at("MemTotal")}.NextNumber<long>()};
+  const long free_memory_kB{
+      parser_helper::FieldTokenizer{map.at("MemFree")}.NextNumber<long>()};
   return ((total_memory_kB - free_memory_kB) * 1.0 / (total_memory_kB));
 }
 
-std::string System::OperatingSystem() const { return os_name_; }
+const std::string& System::OperatingSystem() const { return os_name_; }
+
+std::pmr::memory_resource* System::TickResource() {
+  return tick_arena_.Resource();
+}
+
+const TickSample& System::Sample() {
+  if (tick_sample_.time == std::chrono::steady_clock::time_point{}) {
+    // steady_clock uses CLOCK_MONOTONIC in Linux.
+    tick_sample_.time = std::chrono::steady_clock::now();
+    tick_sample_.cpu = cpu_.Times(tick_arena_.Resource());
+  }
+  return tick_sample_;
+}
+
+std::chrono::steady_clock::time_point System::TickTime() {
+  return Sample().time;
+}
+
+float System::CpuUtilization() { return cpu_.Utilization(Sample()); }
+
+void System::EndTick() {
+  tick_arena_.Reset();
+  tick_sample_ = {};
+}
 
 int System::RunningProcesses() const {
   // On Linux systems we can find the number of running processes in the
   // "/proc/stat" file as the procs_running property.
   const char* kStatFilePath{"/proc/stat"};
-  const auto map =
-      parser_helper::ExtractKeyValuePairsFromFile(kStatFilePath, " ");
-  return std::stoi(map.at("procs_running"));
+  const auto map = parser_helper::ExtractKeyValuePairsFromFile(
+      kStatFilePath, " ", tick_arena_.Resource());
+  return parser_helper::FieldTokenizer{map.at("procs_running")}
+      .NextNumber<int>();
 }
 
 int System::TotalProcesses() const {
   // On Linux systems we can find the total number of processes in the
   // "/proc/stat" file as the processes property.
   const char* kStatFilePath{"/proc/stat"};
-  const auto map =
-      parser_helper::ExtractKeyValuePairsFromFile(kStatFilePath, " ");
-  return std::stoi(map.at("processes"));
+  const auto map = parser_helper::ExtractKeyValuePairsFromFile(
+      kStatFilePath, " ", tick_arena_.Resource());
+  return parser_helper::FieldTokenizer{map.at("processes")}.NextNumber<int>();
 }
 
 long int System::UpTime() const {
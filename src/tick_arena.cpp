@@ -0,0 +1,56 @@
+#include "tick_arena.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+
+TickArena::TickArena(const std::size_t initial_capacity)
+    : capacity_{initial_capacity},
+      buffer_{new std::byte[initial_capacity]} {
+  resource_.emplace(buffer_.get(), capacity_, &overflow_);
+}
+
+std::pmr::memory_resource* TickArena::Resource() { return &*resource_; }
+
+void TickArena::Reset() {
+  if (overflow_.bytes == 0) {
+    // The next allocations start again from the beginning of the buffer.
+    resource_->release();
+    return;
+  }
+
+  // The last tick didn't fit in the buffer, so we make room for all the memory
+  // it used. The old resource must be destroyed before the buffer it points to.
+  const std::size_t new_capacity{
+      std::max(capacity_ * 2, capacity_ + overflow_.bytes)};
+  resource_.reset();
+  buffer_.reset(new std::byte[new_capacity]);
+  capacity_ = new_capacity;
+  overflow_.allocations = 0;
+  overflow_.bytes = 0;
+  resource_.emplace(buffer_.get(), capacity_, &overflow_);
+}
+
+std::size_t TickArena::Capacity() const { return capacity_; }
+
+std::size_t TickArena::OverflowAllocations() const {
+  return overflow_.allocations;
+}
+
+void* TickArena::OverflowResource::do_allocate(const std::size_t bytes,
+                                               const std::size_t alignment) {
+  ++allocations;
+  this->bytes += bytes;
+  return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void TickArena::OverflowResource::do_deallocate(void* p,
+                                                const std::size_t bytes,
+                                                const std::size_t alignment) {
+  std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+bool TickArena::OverflowResource::do_is_equal(
+    const std::pmr::memory_resource& other) const noexcept {
+  return this == &other;
+}
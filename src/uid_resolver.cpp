@@ -33,7 +33,9 @@ std::unordered_map<int, std::string> BuildUidsToUserNameMap() {
 }
 }  // namespace
 
-UidResolver::UidResolver() : uid_to_names_{BuildUidsToUserNameMap()} {}
+// The cache is only built in the first request, so that creating the resolver
+// doesn't delay the program start.
+UidResolver::UidResolver() = default;
 
 std::experimental::optional<std::string> UidResolver::FetchUserName(
     const int uid) {
@@ -0,0 +1,221 @@
+// Checks that a tick of the monitor makes no global heap allocations after
+// warm-up: everything it allocates must come from the tick arena (see
+// TickArena). The global operator new is replaced by a counting version, and
+// the tick samples "/proc" and renders the UI into a terminal that writes to
+// /dev/null.
+//
+// Creating a process object allocates memory, so the ticks in which the host
+// forked new processes are not counted. The host may have no cgroups other
+// than the root, so a cgroup with a long synthetic path is updated too.
+
+#include <curses.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "cgroup.h"
+#include "ncurses_display.h"
+#include "process_columns.h"
+#include "process_viewport.h"
+#include "system.h"
+
+namespace {
+
+// Ticks run before counting, so the arena, the process list and the caches
+// reach their steady state.
+const int kWarmUpTicks{10};
+// Ticks without forks that must make no allocations.
+const int kCountedTicks{20};
+// Maximum number of ticks run, in case the host forks continuously.
+const int kMaxTicks{200};
+const std::chrono::milliseconds kTickInterval{50};
+// Rows of the rendered views.
+const int kRows{40};
+// A cgroup path longer than the small string buffer of std::string. Its files
+// don't need to exist.
+const char* kSyntheticCgroupPath{
+    "/system.slice/tick-allocations-test.slice/synthetic.service"};
+
+std::atomic<bool> counting{false};
+std::atomic<std::size_t> allocations{0};
+
+void* CountedAllocate(std::size_t size) {
+  if (counting.load(std::memory_order_relaxed)) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+
+void* CountedAllocate(std::size_t size, std::align_val_t alignment) {
+  if (counting.load(std::memory_order_relaxed)) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  const std::size_t align{static_cast<std::size_t>(alignment)};
+  // aligned_alloc needs a size that is a multiple of the alignment.
+  if (void* pointer = std::aligned_alloc(
+          align, (std::max(size, std::size_t{1}) + align - 1) / align * align)) {
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+
+// Get the number of processes created since the boot, from "/proc/stat". It
+// only uses the stack, so it can be called while counting.
+unsigned long long ForkCount() {
+  std::array<char, 1 << 16> buffer{};
+  const int fd{open("/proc/stat", O_RDONLY | O_CLOEXEC)};
+  if (fd < 0) {
+    return 0;
+  }
+  const ssize_t size{read(fd, buffer.data(), buffer.size() - 1)};
+  close(fd);
+  const std::string_view content{buffer.data(),
+                                 static_cast<std::size_t>(std::max(
+                                     size, static_cast<ssize_t>(0)))};
+  const std::size_t position{content.find("\nprocesses ")};
+  if (position == std::string_view::npos) {
+    return 0;
+  }
+  return std::strtoull(content.data() + position + 11, nullptr, 10);
+}
+
+// Sample and render one tick, like NCursesDisplay::Display does with all the
+// views.
+void Tick(System& system, ProcessViewport& viewport, Cgroup& cgroup,
+          WINDOW* system_window, WINDOW* process_window) {
+  system.Governor().Update(system.TickTime(), system.TickResource());
+  werase(system_window);
+  werase(process_window);
+  NCursesDisplay::DisplaySystem(system, system_window);
+
+  std::vector<Process>& processes{system.Processes()};
+  process_columns::AllColumns::Sort(processes, ProcessSortKey::kRunQueueDelay,
+                                    system.Sample(), system.TickResource());
+  viewport.Update(processes);
+  NCursesDisplay::ProcessViewOptions options{};
+  options.first_row = viewport.First();
+  options.selected_pid = viewport.SelectedPid();
+  options.show_cgroups = true;
+  NCursesDisplay::DisplayProcesses(processes, process_window, kRows,
+                                   ProcessSortKey::kRunQueueDelay,
+                                   system.Sample(), options,
+                                   system.TickResource());
+  werase(process_window);
+  NCursesDisplay::DisplayCgroups(system.Cgroups(), process_window, kRows,
+                                 CgroupSortKey::kCpu);
+  cgroup.Update("/sys/fs/cgroup", system.TickTime(), system.TickResource());
+  werase(process_window);
+  NCursesDisplay::DisplayDisks(system.Disks(), process_window, kRows,
+                               DiskFilter::kAll);
+  werase(process_window);
+  NCursesDisplay::DisplayInterrupts(system.Interrupts(), process_window,
+                                    kRows);
+  wnoutrefresh(system_window);
+  wnoutrefresh(process_window);
+  doupdate();
+  system.EndTick();
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) { return CountedAllocate(size); }
+void* operator new[](std::size_t size) { return CountedAllocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return CountedAllocate(size, alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return CountedAllocate(size, alignment);
+}
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+void operator delete[](void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+void operator delete(void* pointer, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+
+int main() {
+  // The UI is rendered into a terminal of a known type that writes to
+  // /dev/null.
+  FILE* output{std::fopen("/dev/null", "w")};
+  FILE* input{std::fopen("/dev/null", "r")};
+  SCREEN* screen{newterm("vt100", output, input)};
+  if (screen == nullptr) {
+    std::cerr << "can't create the terminal" << std::endl;
+    return 1;
+  }
+  resizeterm(kRows + 20, 132);
+  WINDOW* system_window{newwin(14, 132, 0, 0)};
+  WINDOW* process_window{newwin(kRows + 3, 132, 14, 0)};
+
+  System system{};
+  ProcessViewport viewport{};
+  viewport.Resize(kRows);
+  Cgroup cgroup{kSyntheticCgroupPath, 2};
+  int counted_ticks{0};
+  std::size_t total_allocations{0};
+  for (int tick = 0; tick < kMaxTicks && counted_ticks < kCountedTicks;
+       ++tick) {
+    const unsigned long long forks_before{ForkCount()};
+    allocations = 0;
+    counting = tick >= kWarmUpTicks;
+    Tick(system, viewport, cgroup, system_window, process_window);
+    counting = false;
+    if (tick >= kWarmUpTicks && ForkCount() == forks_before) {
+      ++counted_ticks;
+      total_allocations += allocations;
+      if (allocations > 0) {
+        std::cerr << "tick " << tick << " made " << allocations
+                  << " heap allocations" << std::endl;
+      }
+    }
+    std::this_thread::sleep_for(kTickInterval);
+  }
+
+  delwin(system_window);
+  delwin(process_window);
+  endwin();
+  delscreen(screen);
+  if (counted_ticks < kCountedTicks) {
+    std::cerr << "only " << counted_ticks << " of " << kCountedTicks
+              << " ticks without forks" << std::endl;
+    return 1;
+  }
+  if (total_allocations > 0) {
+    std::cerr << total_allocations << " heap allocations in " << counted_ticks
+              << " ticks after warm-up" << std::endl;
+    return 1;
+  }
+  std::cout << "no heap allocations in " << counted_ticks
+            << " ticks after warm-up" << std::endl;
+  return 0;
+}